@@ -7,6 +7,8 @@
 #ifndef DORY_BOARD_H
 #define DORY_BOARD_H
 
+DORY_NAMESPACE_BEGIN
+
 struct State {
     constexpr State(bool white, bool wcs, bool wcl, bool bcs, bool bcl) :
             whiteToMove{white}, wCastleShort{wcs}, wCastleLong{wcl},
@@ -74,15 +76,28 @@ template<bool isWhite>
 constexpr BB castleLongRookMove();
 
 
+// what is needed to take back a move played with Board::makeMove
+struct UndoInfo {
+    Piece_t captured{0};
+    BB enPassantField{0};
+    uint16_t halfmoveClock{0};
+};
+
+
 class Board {
 public:
-    const BB wPawns{0}, bPawns{0}, wKnights{0}, bKnights{0}, wBishops{0}, bBishops{0}, wRooks{0}, bRooks{0}, wQueens{0}, bQueens{0}, wKing{0}, bKing{0};
-    const BB enPassantField{0};
+    BB wPawns{0}, bPawns{0}, wKnights{0}, bKnights{0}, wBishops{0}, bBishops{0}, wRooks{0}, bRooks{0}, wQueens{0}, bQueens{0}, wKing{0}, bKing{0};
+    BB enPassantField{0};
+    // plies since the last capture or pawn move and the number of the full move, as in FEN fields 5 and 6
+    uint16_t halfmoveClock{0}, fullmoveNumber{1};
 
     Board() = default;
-    constexpr Board(BB wP, BB bP, BB wN, BB bN, BB wB, BB bB, BB wR, BB bR, BB wQ, BB bQ, BB wK, BB bK, BB ep) :
+    constexpr Board(BB wP, BB bP, BB wN, BB bN, BB wB, BB bB, BB wR, BB bR, BB wQ, BB bQ, BB wK, BB bK, BB ep, uint16_t hmc = 0, uint16_t fmn = 1) :
             wPawns{wP}, bPawns{bP}, wKnights{wN}, bKnights{bN}, wBishops{wB}, bBishops{bB},
-            wRooks{wR}, bRooks{bR}, wQueens{wQ}, bQueens{bQ}, wKing{wK}, bKing{bK}, enPassantField{ep} {}
+            wRooks{wR}, bRooks{bR}, wQueens{wQ}, bQueens{bQ}, wKing{wK}, bKing{bK}, enPassantField{ep},
+            halfmoveClock{hmc}, fullmoveNumber{fmn} {}
+
+    constexpr bool operator==(const Board&) const = default;
 
     template<bool whiteToMove> [[nodiscard]] constexpr BB pawns() const {
         if constexpr (whiteToMove) return wPawns; else return bPawns;
@@ -146,14 +161,131 @@ public:
         return ~myPieces<whiteToMove>();
     }
 
+    template<bool whiteToMove, Piece_t piece>
+    constexpr BB& pieceBB() {
+        if constexpr (piece == Piece::Pawn) return whiteToMove ? wPawns : bPawns;
+        if constexpr (piece == Piece::Knight) return whiteToMove ? wKnights : bKnights;
+        if constexpr (piece == Piece::Bishop) return whiteToMove ? wBishops : bBishops;
+        if constexpr (piece == Piece::Rook) return whiteToMove ? wRooks : bRooks;
+        if constexpr (piece == Piece::Queen) return whiteToMove ? wQueens : bQueens;
+        if constexpr (piece == Piece::King) return whiteToMove ? wKing : bKing;
+    }
+
+    template<bool whiteToMove>
+    constexpr BB& pieceBB(Piece_t piece) {
+        switch (piece) {
+            case Piece::Pawn: return pieceBB<whiteToMove, Piece::Pawn>();
+            case Piece::Knight: return pieceBB<whiteToMove, Piece::Knight>();
+            case Piece::Bishop: return pieceBB<whiteToMove, Piece::Bishop>();
+            case Piece::Rook: return pieceBB<whiteToMove, Piece::Rook>();
+            case Piece::Queen: return pieceBB<whiteToMove, Piece::Queen>();
+            default: return pieceBB<whiteToMove, Piece::King>();
+        }
+    }
+
+    // type of the piece of the given color on the square, 0 if there is none
+    template<bool whiteToMove>
+    [[nodiscard]] constexpr Piece_t pieceAt(BB square) const {
+        if (square & pawns<whiteToMove>()) return Piece::Pawn;
+        if (square & knights<whiteToMove>()) return Piece::Knight;
+        if (square & bishops<whiteToMove>()) return Piece::Bishop;
+        if (square & rooks<whiteToMove>()) return Piece::Rook;
+        if (square & queens<whiteToMove>()) return Piece::Queen;
+        if (square & king<whiteToMove>()) return Piece::King;
+        return 0;
+    }
+
     template<bool whiteToMove, bool diag>
     [[nodiscard]] constexpr BB enemySliders() const {
         if constexpr (whiteToMove) return bQueens | (diag ? bBishops : bRooks);
         else return wQueens | (diag ? wBishops : wRooks);
     }
 
+    [[nodiscard]] constexpr bool isFiftyMoveDraw() const {
+        return halfmoveClock >= 100;
+    }
+
     template<State state, Piece_t piece, Flag_t flags>
     [[nodiscard]] constexpr Board getNextBoard(BB from, BB to) const {
+        Board next = movePieces<state, piece, flags>(from, to);
+        bool irreversible = piece == Piece::Pawn || (to & enemyPieces<state.whiteToMove>());
+        next.halfmoveClock = irreversible ? 0 : halfmoveClock + 1;
+        next.fullmoveNumber = fullmoveNumber + !state.whiteToMove;
+        return next;
+    }
+
+    /**
+     * Plays the move on this board instead of creating a new one as getNextBoard does.
+     * The returned UndoInfo has to be passed to unmakeMove with the same template arguments to take the move back.
+     */
+    template<State state, Piece_t piece, Flag_t flags>
+    constexpr UndoInfo makeMove(BB from, BB to) {
+        constexpr bool white = state.whiteToMove;
+        UndoInfo undo{0, enPassantField, halfmoveClock};
+
+        if constexpr (flags == MoveFlag::ShortCastling) {
+            pieceBB<white, Piece::King>() ^= from | to;
+            pieceBB<white, Piece::Rook>() ^= castleShortRookMove<white>();
+        } else if constexpr (flags == MoveFlag::LongCastling) {
+            pieceBB<white, Piece::King>() ^= from | to;
+            pieceBB<white, Piece::Rook>() ^= castleLongRookMove<white>();
+        } else {
+            if constexpr (flags == MoveFlag::EnPassantCapture) {
+                undo.captured = Piece::Pawn;
+                pieceBB<!white, Piece::Pawn>() ^= backward<white>(to);
+            } else {
+                undo.captured = pieceAt<!white>(to);
+                if (undo.captured) pieceBB<!white>(undo.captured) ^= to;
+            }
+
+            if constexpr (isPromotion(flags)) {
+                pieceBB<white, Piece::Pawn>() ^= from;
+                pieceBB<white, promotedPiece<flags>()>() |= to;
+            } else {
+                pieceBB<white, piece>() ^= from | to;
+            }
+        }
+
+        enPassantField = flags == MoveFlag::PawnDoublePush ? forward<white>(from) : 0ull;
+        halfmoveClock = piece == Piece::Pawn || undo.captured ? 0 : halfmoveClock + 1;
+        fullmoveNumber += !white;
+        return undo;
+    }
+
+    template<State state, Piece_t piece, Flag_t flags>
+    constexpr void unmakeMove(BB from, BB to, UndoInfo undo) {
+        constexpr bool white = state.whiteToMove;
+
+        if constexpr (flags == MoveFlag::ShortCastling) {
+            pieceBB<white, Piece::King>() ^= from | to;
+            pieceBB<white, Piece::Rook>() ^= castleShortRookMove<white>();
+        } else if constexpr (flags == MoveFlag::LongCastling) {
+            pieceBB<white, Piece::King>() ^= from | to;
+            pieceBB<white, Piece::Rook>() ^= castleLongRookMove<white>();
+        } else {
+            if constexpr (isPromotion(flags)) {
+                pieceBB<white, Piece::Pawn>() |= from;
+                pieceBB<white, promotedPiece<flags>()>() ^= to;
+            } else {
+                pieceBB<white, piece>() ^= from | to;
+            }
+
+            if constexpr (flags == MoveFlag::EnPassantCapture) {
+                pieceBB<!white, Piece::Pawn>() |= backward<white>(to);
+            } else {
+                if (undo.captured) pieceBB<!white>(undo.captured) |= to;
+            }
+        }
+
+        enPassantField = undo.enPassantField;
+        halfmoveClock = undo.halfmoveClock;
+        fullmoveNumber -= !white;
+    }
+
+private:
+    // piece placement and en passant field after the move, the move counters are set by getNextBoard
+    template<State state, Piece_t piece, Flag_t flags>
+    [[nodiscard]] constexpr Board movePieces(BB from, BB to) const {
         constexpr bool whiteMoved = state.whiteToMove;
         BB change = from | to;
 
@@ -223,6 +355,8 @@ constexpr Board STARTBOARD = Board(rank2, rank7, 0x42, 0x42ull << 7*8, 0x24, 0x2
 struct ExtendedBoard {
     Board board{};
     uint8_t state_code{};
+
+    constexpr bool operator==(const ExtendedBoard&) const = default;
 };
 
 template<State state>
@@ -266,6 +400,7 @@ constexpr BB castleLongRookMove() {
     else return 0b1001ull << (singleBitOf(STARTBOARD.bKing) - 4);
 }
 
+DORY_NAMESPACE_END
 
 #endif //DORY_BOARD_H
 
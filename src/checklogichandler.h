@@ -4,10 +4,13 @@
 
 #include "board.h"
 #include "piecesteps.h"
+#include "sliderattacks.h"
 
 #ifndef DORY_CHECKLOGICHANDLER_H
 #define DORY_CHECKLOGICHANDLER_H
 
+DORY_NAMESPACE_BEGIN
+
 struct PinData {
     bool isDoubleCheck{false}, blockEP{false};
     BB attacked{0}, checkMask{0}, targetSquares{0}, pinsStr{0}, pinsDiag{0};
@@ -15,48 +18,49 @@ struct PinData {
 
 class CheckLogicHandler {
     template<State, bool>
-    static BB addPins(const Board& board, int kingSquare, bool& blockEP);
+    static BB addSnipers(const Board& board, int kingSquare, BB snipers, int& numChecks, BB& checkMask, bool& blockEP);
 
 public:
-    template<State>
+    // SliderKernel computes the squares attacked by the enemy sliders, see sliderattacks.h
+    template<State, typename SliderKernel = SliderAttacks::PerPiece>
     static PinData reload(Board& board);
 };
 
+/*
+ * Snipers are the enemy sliders that would attack the king on an empty board. The pieces between a sniper
+ * and the king decide what it does: none means check, a single own piece is pinned and a pair of pawns
+ * (one own, one enemy) on the king's rank must not capture en passant. Returns the pin lines, which
+ * include the pinning piece.
+ */
 template<State state, bool diag>
-BB CheckLogicHandler::addPins(const Board& board, int kingSquare, bool& blockEP){
+BB CheckLogicHandler::addSnipers(const Board& board, int kingSquare, BB snipers, int& numChecks, BB& checkMask, bool& blockEP){
     constexpr bool white = state.whiteToMove;
-    std::array<BB, 8> kingLines = PieceSteps::LINES[kingSquare];
-    auto dirs = diag ? PieceSteps::diagonal : PieceSteps::straight;
-    BB pieces = board.enemySliders<white, diag>();
-    BB mask = 0;
-
-    for(int dir_id: dirs) {
-        int dir_off = PieceSteps::directions[dir_id];
-        BB line = kingLines[dir_id];
-        BB sol = line & pieces;
-        if(sol) {
-            int ix = dir_off > 0 ? firstBitOf(sol) : lastBitOf(sol);
-            BB kl = line & PieceSteps::FROM_TO[kingSquare][ix];
-            if(
-                bitCount(kl & board.enemyPieces<white>()) == 1             // only enemyPieces piece on line is the slider
-                && bitCount(kl & board.myPieces<white>()) == 1             // I only have one piece on line (excluding king)
-            ) mask |= kl;
-
+    BB occ = board.occ();
+    BB pins = 0;
+    snipers &= PieceSteps::slideMask<diag>(0, kingSquare);
+
+    Bitloop(snipers) {
+        int ix = firstBitOf(snipers);
+        BB blockers = PieceSteps::BETWEEN[kingSquare][ix] & occ;
+        BB line = PieceSteps::FROM_TO[kingSquare][ix];
+        if(!blockers) {
+            numChecks++;
+            checkMask |= line;
+        } else if(!(blockers & (blockers - 1))) {
+            if(blockers & board.myPieces<white>()) pins |= line;
+        } else if constexpr (!diag) {
             // handle very special case of two sideways pinned epPawns
-            // add pin line through two pawns to prevent pinned en passant
-            else if(board.enPassantField
-                && (dir_id == PieceSteps::DIR_LEFT || dir_id == PieceSteps::DIR_RIGHT)
-                && rankOf(kingSquare) == epRankNr<white>()
-                && bitCount(kl & board.pawns<white>()) == 1         // one own pawn
-                && bitCount(kl & board.enemyPawns<white>()) == 1    // one enemy pawn
-                && bitCount(kl & board.occ()) == 3  // 2 pawns + 1 king = 3 total pieces on line
+            if(board.enPassantField
+                && rankOf(kingSquare) == epRankNr<white>() && rankOf(ix) == rankOf(kingSquare)
+                && bitCount(blockers) == 2
+                && (blockers & board.pawns<white>()) && (blockers & board.enemyPawns<white>())
             ) blockEP = true;
         }
     }
-    return mask;
+    return pins;
 }
 
-template<State state>
+template<State state, typename SliderKernel>
 PinData CheckLogicHandler::reload(Board& board){
     constexpr bool white = state.whiteToMove;
     BB attacked{0}, checkMask{0}, mask;
@@ -103,39 +107,22 @@ PinData CheckLogicHandler::reload(Board& board){
         }
     }
 
-    // Bishops & (diagonal) Queens
-    BB pieces = bishopBB | queenBB;
-    Bitloop(pieces) {
-        int ix = firstBitOf(pieces);
-        mask = PieceSteps::slideMask<true>(board.occ() ^ myKing, ix);
-        attacked |= mask;
-        if(mask & myKing) {
-            numChecks++;
-            checkMask |= PieceSteps::FROM_TO[kingSquare][ix];
-        }
-    }
+    // Sliders, the king is removed so that squares behind it count as attacked
+    BB diagonal = bishopBB | queenBB, straight = rookBB | queenBB;
+    attacked |= SliderKernel::attacks(diagonal, straight, board.occ() ^ myKing);
 
-    // Rooks & (straight) Queens
-    pieces = rookBB | queenBB;
-    Bitloop(pieces) {
-        int ix = firstBitOf(pieces);
-        mask = PieceSteps::slideMask<false>(board.occ() ^ myKing, ix);
-        attacked |= mask;
-        if(mask & myKing) {
-            numChecks++;
-            checkMask |= PieceSteps::FROM_TO[kingSquare][ix];
-        }
-    }
+    // Checks and pins by sliders
+    BB pinsDiagonal = addSnipers<state, true>(board, kingSquare, diagonal, numChecks, checkMask, blockEP);
+    BB pinsStraight = addSnipers<state, false>(board, kingSquare, straight, numChecks, checkMask, blockEP);
 
     bool isDoubleCheck = numChecks > 1;
     if(isDoubleCheck) checkMask = 0;
-
-    BB pinsDiagonal = addPins<state, true>(board, kingSquare, blockEP);
-    BB pinsStraight = addPins<state, false>(board, kingSquare, blockEP);
     if(numChecks == 0) checkMask = FULL_BB;
     BB targetSquares = board.enemyOrEmpty<state.whiteToMove>() & checkMask;
 
     return { isDoubleCheck, blockEP, attacked, checkMask, targetSquares, pinsStraight, pinsDiagonal };
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_CHECKLOGICHANDLER_H
@@ -7,10 +7,15 @@
 
 #include <immintrin.h>
 
+#include "isa.h"
+
 #ifndef DORY_CHESS_H
 #define DORY_CHESS_H
 
-#define Bitloop(X) for(;X; X = _blsr_u64(X))
+DORY_NAMESPACE_BEGIN
+
+// X & (X - 1) and X & -X compile to BLSR / BLSI where BMI1 is available and stay valid on every other x86-64 CPU
+#define Bitloop(X) for(;X; X &= X - 1)
 
 using BB = uint64_t;
 using square = uint64_t;
@@ -43,11 +48,45 @@ namespace MoveFlag {
     const Flag_t LongCastling = 11;
 }
 
+constexpr bool isPromotion(Flag_t flags) {
+    return flags >= MoveFlag::PromoteQueen && flags <= MoveFlag::PromoteKnight;
+}
+
+template<Flag_t flags>
+constexpr Piece_t promotedPiece() {
+    if constexpr (flags == MoveFlag::PromoteQueen) return Piece::Queen;
+    if constexpr (flags == MoveFlag::PromoteRook) return Piece::Rook;
+    if constexpr (flags == MoveFlag::PromoteBishop) return Piece::Bishop;
+    return Piece::Knight;
+}
+
 struct Move {
     BB from{0}, to{0};
     uint8_t piece{0}, flags{0};
 };
 
+// upper bound for the number of legal moves in any position
+constexpr int MAX_MOVES = 256;
+
+// from square in bits 0-5, to square in bits 6-11 and the move flag in bits 12-15
+using PackedMove = uint16_t;
+
+static constexpr PackedMove packMove(BB from, BB to, Flag_t flags) {
+    return __builtin_ctzll(from) | (__builtin_ctzll(to) << 6) | (flags << 12);
+}
+
+static constexpr int packedFrom(PackedMove move) {
+    return move & 0x3f;
+}
+
+static constexpr int packedTo(PackedMove move) {
+    return (move >> 6) & 0x3f;
+}
+
+static constexpr Flag_t packedFlags(PackedMove move) {
+    return move >> 12;
+}
+
 
 // ---------- BOARD GEOMETRY ----------
 
@@ -126,9 +165,8 @@ static constexpr int singleBitOf(BB number) {
     return firstBitOf(number);
 }
 
-static BB isolateLowestBit(BB number) {
-    // calculates number & -number;
-    return _blsi_u64(number);
+static constexpr BB isolateLowestBit(BB number) {
+    return number & -number;
 }
 
 // ------------- PAWN MOVES -------------
@@ -182,4 +220,6 @@ template<bool whiteToMove> constexpr BB firstRank() {
     else return rank7;
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_CHESS_H
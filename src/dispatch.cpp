@@ -0,0 +1,72 @@
+//
+// Created by Robin on 18.10.2026.
+//
+
+/*
+ * Entry point of Dory when built with DORY_DISPATCH. The program is compiled once per x86-64 level (see main.cpp
+ * and isa.h) and the best variant the CPU supports is picked once at startup. Setting the environment variable
+ * DORY_ISA to one of the variant names overrides the choice.
+ */
+
+#include <cpuid.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace x86_64 { int runDory(int argc, char* argv[]); }
+namespace x86_64_v3_nopext { int runDory(int argc, char* argv[]); }
+namespace x86_64_v3 { int runDory(int argc, char* argv[]); }
+namespace x86_64_v4 { int runDory(int argc, char* argv[]); }
+
+struct Variant {
+    const char* name;
+    int (*run)(int, char**);
+};
+
+constexpr Variant VARIANTS[] = {
+    { "x86-64", &x86_64::runDory },
+    { "x86-64-v3-nopext", &x86_64_v3_nopext::runDory },
+    { "x86-64-v3", &x86_64_v3::runDory },
+    { "x86-64-v4", &x86_64_v4::runDory },
+};
+
+// AMD CPUs before Zen 3 (family 0x19) implement PEXT / PDEP in microcode with a latency of up to ~300 cycles
+bool hasSlowPext() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return false;
+    char vendor[13];
+    std::memcpy(vendor, &ebx, 4);
+    std::memcpy(vendor + 4, &edx, 4);
+    std::memcpy(vendor + 8, &ecx, 4);
+    vendor[12] = '\0';
+    if (std::strcmp(vendor, "AuthenticAMD") != 0) return false;
+
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    unsigned family = (eax >> 8) & 0xf;
+    if (family == 0xf) family += (eax >> 20) & 0xff;
+    return family < 0x19;
+}
+
+const Variant& selectVariant() {
+    __builtin_cpu_init();
+    bool v3 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2")
+              && __builtin_cpu_supports("fma") && __builtin_cpu_supports("popcnt");
+    bool v4 = v3 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+              && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+
+    if (v4 && !hasSlowPext()) return VARIANTS[3];
+    if (v3) return hasSlowPext() ? VARIANTS[1] : VARIANTS[2];
+    return VARIANTS[0];
+}
+
+int main(int argc, char* argv[]) {
+    const Variant* variant = &selectVariant();
+
+    if (const char* forced = std::getenv("DORY_ISA")) {
+        for (const Variant& v: VARIANTS)
+            if (std::strcmp(v.name, forced) == 0) variant = &v;
+        std::cerr << "Using " << variant->name << " kernels" << std::endl;
+    }
+
+    return variant->run(argc, argv);
+}
@@ -0,0 +1,174 @@
+//
+// Created by Robin on 18.10.2026.
+//
+
+#include <mutex>
+
+#include "dory.h"
+#include "movecollectors.h"
+#include "fenreader.h"
+
+namespace {
+
+    Board toBoard(const dory_position* pos) {
+        const uint64_t* bb = pos->bitboards;
+        return {bb[DORY_WHITE_PAWNS], bb[DORY_BLACK_PAWNS], bb[DORY_WHITE_KNIGHTS], bb[DORY_BLACK_KNIGHTS],
+                bb[DORY_WHITE_BISHOPS], bb[DORY_BLACK_BISHOPS], bb[DORY_WHITE_ROOKS], bb[DORY_BLACK_ROOKS],
+                bb[DORY_WHITE_QUEENS], bb[DORY_BLACK_QUEENS], bb[DORY_WHITE_KING], bb[DORY_BLACK_KING], pos->en_passant,
+                pos->halfmove_clock, pos->fullmove_number};
+    }
+
+    void fromBoard(const Board& board, uint8_t state_code, dory_position* out) {
+        uint64_t* bb = out->bitboards;
+        bb[DORY_WHITE_PAWNS] = board.wPawns;     bb[DORY_BLACK_PAWNS] = board.bPawns;
+        bb[DORY_WHITE_KNIGHTS] = board.wKnights; bb[DORY_BLACK_KNIGHTS] = board.bKnights;
+        bb[DORY_WHITE_BISHOPS] = board.wBishops; bb[DORY_BLACK_BISHOPS] = board.bBishops;
+        bb[DORY_WHITE_ROOKS] = board.wRooks;     bb[DORY_BLACK_ROOKS] = board.bRooks;
+        bb[DORY_WHITE_QUEENS] = board.wQueens;   bb[DORY_BLACK_QUEENS] = board.bQueens;
+        bb[DORY_WHITE_KING] = board.wKing;       bb[DORY_BLACK_KING] = board.bKing;
+        out->en_passant = board.enPassantField;
+        out->state = state_code;
+        out->halfmove_clock = board.halfmoveClock;
+        out->fullmove_number = board.fullmoveNumber;
+    }
+
+    void ensureLoaded() {
+        static std::once_flag loaded;
+        std::call_once(loaded, PieceSteps::load);
+    }
+
+    // The collectors keep their output in thread local variables, so the library can be used from multiple threads
+
+    struct LegalMoves {
+        static thread_local dory_move* out;
+        static thread_local size_t cap, count;
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            MoveGenerator<LegalMoves>::template generate<state, 1>(board);
+        }
+
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove([[maybe_unused]] const Board &board, BB from, BB to) {
+            if(count < cap) out[count] = { static_cast<uint8_t>(singleBitOf(from)), static_cast<uint8_t>(singleBitOf(to)), piece, flags };
+            count++;
+        }
+
+        template<State nextState, int depth>
+        static void next([[maybe_unused]] Board& nextBoard) {}
+    };
+
+    thread_local dory_move* LegalMoves::out{nullptr};
+    thread_local size_t LegalMoves::cap{0};
+    thread_local size_t LegalMoves::count{0};
+
+
+    struct Perft {
+        static thread_local uint64_t leaves;
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            MoveGenerator<Perft>::template generate<state, depth>(board);
+        }
+
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove([[maybe_unused]] const Board &board, [[maybe_unused]] BB from, [[maybe_unused]] BB to) {
+            if constexpr (depth == 1) leaves++;
+        }
+
+        template<State nextState, int depth>
+        static void next(Board& nextBoard) {
+            if constexpr (depth > 1) {
+                MoveGenerator<Perft>::template generate<nextState, depth-1>(nextBoard);
+            }
+        }
+    };
+
+    thread_local uint64_t Perft::leaves{0};
+
+
+    struct ApplyMove {
+        static thread_local dory_move move;
+        static thread_local bool matched, found;
+        static thread_local ExtendedBoard result;
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            MoveGenerator<ApplyMove>::template generate<state, 1>(board);
+        }
+
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove([[maybe_unused]] const Board &board, BB from, BB to) {
+            matched = !found && singleBitOf(from) == move.from && singleBitOf(to) == move.to && piece == move.piece
+                      && (flags == move.flags || (flags < MoveFlag::PawnDoublePush && move.flags < MoveFlag::PawnDoublePush));
+        }
+
+        template<State nextState, int depth>
+        static void next(Board& nextBoard) {
+            if(matched) {
+                result = getExtendedBoard<nextState>(nextBoard);
+                found = true;
+            }
+        }
+    };
+
+    thread_local dory_move ApplyMove::move{};
+    thread_local bool ApplyMove::matched{false};
+    thread_local bool ApplyMove::found{false};
+    thread_local ExtendedBoard ApplyMove::result{};
+}
+
+extern "C" {
+
+int dory_position_from_fen(const char* fen, dory_position* out) {
+    try {
+        ExtendedBoard eboard = Utils::parseFEN(fen);
+        fromBoard(eboard.board, eboard.state_code, out);
+        return 0;
+    } catch (std::exception& ex) {
+        return -1;
+    }
+}
+
+size_t dory_position_to_fen(const dory_position* pos, char* buf, size_t cap) {
+    if(cap < Utils::MAX_FEN_LENGTH) return 0;
+    return Utils::toFEN(toBoard(pos), pos->state, pos->halfmove_clock, pos->fullmove_number, buf);
+}
+
+size_t dory_legal_moves(const dory_position* pos, dory_move* out, size_t cap) {
+    ensureLoaded();
+    Board board = toBoard(pos);
+    LegalMoves::out = out;
+    LegalMoves::cap = cap;
+    LegalMoves::count = 0;
+    Utils::run<LegalMoves, 1>(pos->state, board);
+    return LegalMoves::count;
+}
+
+void dory_legal_moves_batch(const dory_position* positions, size_t count, dory_move* out, size_t cap, size_t* counts) {
+    for(size_t i = 0; i < count; i++) {
+        counts[i] = dory_legal_moves(positions + i, out + i * cap, cap);
+    }
+}
+
+uint64_t dory_perft(const dory_position* pos, int depth) {
+    if(depth < 1 || depth > 9) return 0;
+    ensureLoaded();
+    Board board = toBoard(pos);
+    Perft::leaves = 0;
+    Utils::run<Perft>(pos->state, board, depth);
+    return Perft::leaves;
+}
+
+int dory_apply_move(const dory_position* pos, dory_move move, dory_position* out) {
+    ensureLoaded();
+    Board board = toBoard(pos);
+    ApplyMove::move = move;
+    ApplyMove::found = false;
+    Utils::run<ApplyMove, 1>(pos->state, board);
+    if(!ApplyMove::found) return -1;
+    fromBoard(ApplyMove::result.board, ApplyMove::result.state_code, out);
+    return 0;
+}
+
+}
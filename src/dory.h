@@ -0,0 +1,98 @@
+/*
+ * C interface of the Dory move generator.
+ *
+ * Link against the `dory` library target (static or shared, see BUILD_SHARED_LIBS) and include only this header.
+ * All functions are thread safe and can be called concurrently on different positions.
+ *
+ * Note: the library contains its own copy of the C++ headers in src/, so a C++ program linking against it
+ * must not compile those headers into another translation unit of the same binary.
+ */
+
+#ifndef DORY_DORY_H
+#define DORY_DORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(DORY_BUILDING_LIBRARY) && defined(__GNUC__)
+#define DORY_API __attribute__((visibility("default")))
+#else
+#define DORY_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* upper bound for the number of legal moves in any position */
+#define DORY_MAX_MOVES 256
+
+/* indices into dory_position.bitboards, squares are numbered a1 = 0, b1 = 1, ..., h8 = 63 */
+enum {
+    DORY_WHITE_PAWNS, DORY_BLACK_PAWNS, DORY_WHITE_KNIGHTS, DORY_BLACK_KNIGHTS,
+    DORY_WHITE_BISHOPS, DORY_BLACK_BISHOPS, DORY_WHITE_ROOKS, DORY_BLACK_ROOKS,
+    DORY_WHITE_QUEENS, DORY_BLACK_QUEENS, DORY_WHITE_KING, DORY_BLACK_KING
+};
+
+/* bits of dory_position.state */
+#define DORY_WHITE_TO_MOVE          0x10
+#define DORY_WHITE_CASTLE_SHORT     0x08
+#define DORY_WHITE_CASTLE_LONG      0x04
+#define DORY_BLACK_CASTLE_SHORT     0x02
+#define DORY_BLACK_CASTLE_LONG      0x01
+
+/* values of dory_move.piece */
+#define DORY_KING   1
+#define DORY_QUEEN  2
+#define DORY_ROOK   3
+#define DORY_BISHOP 4
+#define DORY_KNIGHT 5
+#define DORY_PAWN   6
+
+/* values of dory_move.flags that matter to callers, all other values denote regular moves */
+#define DORY_FLAG_DOUBLE_PUSH       4
+#define DORY_FLAG_EN_PASSANT        5
+#define DORY_FLAG_PROMOTE_QUEEN     6
+#define DORY_FLAG_PROMOTE_ROOK      7
+#define DORY_FLAG_PROMOTE_BISHOP    8
+#define DORY_FLAG_PROMOTE_KNIGHT    9
+#define DORY_FLAG_CASTLE_SHORT      10
+#define DORY_FLAG_CASTLE_LONG       11
+
+typedef struct dory_position {
+    uint64_t bitboards[12];
+    uint64_t en_passant;    /* bitboard of the en passant target square, 0 if there is none */
+    uint8_t state;          /* side to move and castling rights, see DORY_WHITE_TO_MOVE etc. */
+    uint16_t halfmove_clock, fullmove_number;
+} dory_position;
+
+typedef struct dory_move {
+    uint8_t from, to;       /* square indices, for castling these are the king squares */
+    uint8_t piece, flags;
+} dory_move;
+
+/* Parses a FEN string, the move counters are optional. Returns 0 on success and -1 for invalid input. */
+DORY_API int dory_position_from_fen(const char* fen, dory_position* out);
+
+/* Writes the FEN string of pos into buf, which should hold at least 104 characters.
+ * Returns the length of the string or 0 if cap is too small. */
+DORY_API size_t dory_position_to_fen(const dory_position* pos, char* buf, size_t cap);
+
+/* Writes up to cap legal moves of pos into out and returns the total number of legal moves. */
+DORY_API size_t dory_legal_moves(const dory_position* pos, dory_move* out, size_t cap);
+
+/* Generates the legal moves of count positions. The moves of positions[i] are written to out + i * cap
+ * and their number to counts[i]. */
+DORY_API void dory_legal_moves_batch(const dory_position* positions, size_t count, dory_move* out, size_t cap, size_t* counts);
+
+/* Number of leaf nodes of the game tree below pos at the given depth (1 to 9). Returns 0 for unsupported depths. */
+DORY_API uint64_t dory_perft(const dory_position* pos, int depth);
+
+/* Plays a legal move of pos and writes the resulting position to out. Returns 0 on success and -1 if move is not legal. */
+DORY_API int dory_apply_move(const dory_position* pos, dory_move move, dory_position* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DORY_DORY_H */
@@ -6,10 +6,14 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <stdexcept>
+#include <chrono>
 
 #ifndef DORY_FENREADER_H
 #define DORY_FENREADER_H
 
+DORY_NAMESPACE_BEGIN
+
 namespace Utils {
     constexpr Board getBoardFromFEN(std::string_view position, std::string_view ep) {
         int rank{7}, file{0};
@@ -114,35 +118,197 @@ namespace Utils {
         }
     }
 
-    template<typename Main, int depth>
-    void loadFEN(std::string_view full_fen) {
-        std::stringstream stream(full_fen.data());
-        std::string segment;
-        std::vector<std::string> seglist;
-        try {
-            while(std::getline(stream, segment, ' ')) seglist.push_back(segment);
+    template<typename Main>
+    void run(uint8_t state_code, Board& board, int depth) {
+        switch(depth) {
+            case 1: run<Main, 1>(state_code, board); break;
+            case 2: run<Main, 2>(state_code, board); break;
+            case 3: run<Main, 3>(state_code, board); break;
+            case 4: run<Main, 4>(state_code, board); break;
+            case 5: run<Main, 5>(state_code, board); break;
+            case 6: run<Main, 6>(state_code, board); break;
+            case 7: run<Main, 7>(state_code, board); break;
+            case 8: run<Main, 8>(state_code, board); break;
+            case 9: run<Main, 9>(state_code, board); break;
+            default: std::cerr << "Depth not implemented!" << std::endl;
+        }
+    }
+
+    /**
+     * Parses a full FEN string into a board and its state code.
+     * The move counters (fields 5 and 6) are optional and default to 0 and 1.
+     *
+     * @throws std::invalid_argument if one of the mandatory fields is missing or malformed
+     */
+    ExtendedBoard parseFEN(std::string_view full_fen) {
+        std::array<std::string_view, 6> fields{};
+        size_t numFields = 0;
+        while(numFields < fields.size()) {
+            size_t start = full_fen.find_first_not_of(' ');
+            if(start == std::string_view::npos) break;
+            full_fen.remove_prefix(start);
+            size_t end = full_fen.find(' ');
+            fields[numFields++] = full_fen.substr(0, end);
+            full_fen.remove_prefix(end == std::string_view::npos ? full_fen.size() : end);
+        }
+        if(numFields < 4) throw std::invalid_argument("FEN string needs at least 4 fields");
+
+        // en passant square has to be either '-' or a square on the third or sixth rank
+        std::string_view ep = fields[3];
+        if(ep != "-" && (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || (ep[1] != '3' && ep[1] != '6')))
+            throw std::invalid_argument("invalid en passant square");
+
+        // first position in FEN is board contents
+        Board board = getBoardFromFEN(fields[0], ep);
+
+        // second position is side to move
+        if(fields[1] != "w" && fields[1] != "b") throw std::invalid_argument("invalid side to move");
+        const bool w = fields[1] == "w";
+
+        // castling rights
+        std::string_view castling = fields[2];
+        const bool wcs = castling.find('K') != std::string_view::npos;
+        const bool wcl = castling.find('Q') != std::string_view::npos;
+        const bool bcs = castling.find('k') != std::string_view::npos;
+        const bool bcl = castling.find('q') != std::string_view::npos;
+
+        uint8_t state_code = 0;
+        if(w)   state_code |= 0b10000;
+        if(wcs) state_code |= 0b1000;
+        if(wcl) state_code |= 0b100;
+        if(bcs) state_code |= 0b10;
+        if(bcl) state_code |= 0b1;
+
+        auto parseCounter = [](std::string_view field, uint16_t fallback) {
+            if(field.empty()) return fallback;
+            unsigned value = 0;
+            for(char c: field) {
+                if(!isdigit(c) || value > 6553) throw std::invalid_argument("invalid move counter");
+                value = 10 * value + (c - '0');
+            }
+            if(value > UINT16_MAX) throw std::invalid_argument("invalid move counter");
+            return static_cast<uint16_t>(value);
+        };
+        board.halfmoveClock = parseCounter(fields[4], 0);
+        board.fullmoveNumber = parseCounter(fields[5], 1);
+
+        return { board, state_code };
+    }
 
-            // first position in FEN is board contents
-            Board board = getBoardFromFEN(seglist.at(0), seglist.at(3));
+    // Upper bound for the length of a FEN string written by toFEN, including the terminating null byte
+    constexpr size_t MAX_FEN_LENGTH = 104;
 
-            // second position is side to move
-            const bool w = seglist.at(1) == "w";
+    /**
+     * Writes the FEN string of the given position into buf, which needs to hold at least MAX_FEN_LENGTH characters.
+     * The piece placement is built by scanning the bitboards, so this is cheap enough for bulk position exports.
+     *
+     * @return the number of characters written, excluding the terminating null byte
+     */
+    size_t toFEN(const Board& board, uint8_t state_code, unsigned halfmove, unsigned fullmove, char* buf) {
+        std::array<char, 64> squares{};
+        auto place = [&squares](BB pieces, char letter) {
+            Bitloop(pieces) squares[firstBitOf(pieces)] = letter;
+        };
+        place(board.wPawns, 'P');   place(board.bPawns, 'p');
+        place(board.wKnights, 'N'); place(board.bKnights, 'n');
+        place(board.wBishops, 'B'); place(board.bBishops, 'b');
+        place(board.wRooks, 'R');   place(board.bRooks, 'r');
+        place(board.wQueens, 'Q');  place(board.bQueens, 'q');
+        place(board.wKing, 'K');    place(board.bKing, 'k');
 
-            // castling rights
-            const bool wcs = seglist.at(2).find('K') != std::string::npos;
-            const bool wcl = seglist.at(2).find('Q') != std::string::npos;
-            const bool bcs = seglist.at(2).find('k') != std::string::npos;
-            const bool bcl = seglist.at(2).find('q') != std::string::npos;
+        char* out = buf;
+        for(int rank = 7; rank >= 0; rank--) {
+            char empty = '0';
+            for(int file = 0; file < 8; file++) {
+                char letter = squares[8 * rank + file];
+                if(letter == 0) {
+                    empty++;
+                    continue;
+                }
+                if(empty != '0') *out++ = empty;
+                empty = '0';
+                *out++ = letter;
+            }
+            if(empty != '0') *out++ = empty;
+            if(rank > 0) *out++ = '/';
+        }
+
+        *out++ = ' ';
+        *out++ = (state_code & 0b10000) ? 'w' : 'b';
+
+        *out++ = ' ';
+        if((state_code & 0b1111) == 0) *out++ = '-';
+        if(state_code & 0b1000) *out++ = 'K';
+        if(state_code & 0b100)  *out++ = 'Q';
+        if(state_code & 0b10)   *out++ = 'k';
+        if(state_code & 0b1)    *out++ = 'q';
+
+        *out++ = ' ';
+        if(board.enPassantField) {
+            int ix = singleBitOf(board.enPassantField);
+            *out++ = filename(fileOf(ix));
+            *out++ = static_cast<char>('1' + rankOf(ix));
+        } else *out++ = '-';
+
+        auto writeNumber = [&out](unsigned value) {
+            char digits[10];
+            int n = 0;
+            do {
+                digits[n++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while(value);
+            while(n) *out++ = digits[--n];
+        };
+        *out++ = ' ';
+        writeNumber(halfmove);
+        *out++ = ' ';
+        writeNumber(fullmove);
+
+        *out = '\0';
+        return out - buf;
+    }
+
+    std::string toFEN(const Board& board, uint8_t state_code) {
+        char buf[MAX_FEN_LENGTH];
+        return { buf, toFEN(board, state_code, board.halfmoveClock, board.fullmoveNumber, buf) };
+    }
+
+    /**
+     * Measures the throughput of toFEN alone and of a full toFEN / parseFEN round trip over the given positions.
+     */
+    void time_fen_roundtrip(const std::vector<ExtendedBoard>& positions, int rounds) {
+        char buf[MAX_FEN_LENGTH];
+        size_t chars{0}, mismatches{0};
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for(int r = 0; r < rounds; r++)
+            for(const ExtendedBoard& eboard: positions)
+                chars += toFEN(eboard.board, eboard.state_code, eboard.board.halfmoveClock, eboard.board.fullmoveNumber, buf);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        for(int r = 0; r < rounds; r++) {
+            for(const ExtendedBoard& eboard: positions) {
+                size_t length = toFEN(eboard.board, eboard.state_code, eboard.board.halfmoveClock, eboard.board.fullmoveNumber, buf);
+                if(parseFEN({buf, length}) != eboard) mismatches++;
+            }
+        }
+        auto t3 = std::chrono::high_resolution_clock::now();
 
-            uint8_t state_code = 0;
-            if(w)   state_code |= 0b10000;
-            if(wcs) state_code |= 0b1000;
-            if(wcl) state_code |= 0b100;
-            if(bcs) state_code |= 0b10;
-            if(bcl) state_code |= 0b1;
+        double total = static_cast<double>(positions.size()) * rounds;
+        std::chrono::duration<double> writeSeconds = t2 - t1;
+        std::chrono::duration<double> roundtripSeconds = t3 - t2;
 
-            run<Main, depth>(state_code, board);
+        std::cout << "Wrote " << static_cast<size_t>(total) << " FEN strings (" << chars << " chars) in "
+                  << duration_cast<std::chrono::milliseconds>(t2 - t1).count() << "ms\n";
+        std::cout << (total / 1000000) / writeSeconds.count() << " M FEN/s written\n";
+        std::cout << (total / 1000000) / roundtripSeconds.count() << " M FEN/s round trip, "
+                  << mismatches << " mismatches\n\n";
+    }
 
+    template<typename Main, int depth>
+    void loadFEN(std::string_view full_fen) {
+        try {
+            ExtendedBoard eboard = parseFEN(full_fen);
+            run<Main, depth>(eboard.state_code, eboard.board);
         } catch (std::exception& ex) {
             std::cerr << "Invalid FEN string!" << std::endl;
         }
@@ -182,4 +348,6 @@ namespace Utils {
     }
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_FENREADER_H
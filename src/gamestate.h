@@ -0,0 +1,87 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include "movegen.h"
+#include "fenreader.h"
+
+#ifndef DORY_GAMESTATE_H
+#define DORY_GAMESTATE_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Detection of checkmate and stalemate without generating the successor positions.
+ * hasLegalMove stops at the first piece that has a legal target and tries the cheap candidates first.
+ */
+namespace GameState {
+
+    // checkMask is FULL_BB without a check and 0 for a double check
+    inline bool isInCheck(const PinData& pd) {
+        return pd.checkMask != FULL_BB;
+    }
+
+    template<State state>
+    bool hasLegalMove(const Board& board, const PinData& pd) {
+        if(MoveTargets::king<state>(board, pd)) return true;
+        // only the king can escape a double check
+        if(pd.isDoubleCheck) return false;
+
+        BB knights = MoveTargets::knights<state>(board, pd);
+        Bitloop(knights) if(MoveTargets::knight(pd, firstBitOf(knights))) return true;
+
+        MoveTargets::Pawns p = MoveTargets::pawns<state>(board, pd);
+        if(p.push | p.captureLeft | p.captureRight | p.promotePush | p.promoteLeft | p.promoteRight
+           | p.doublePush | p.epLeft | p.epRight) return true;
+
+        BB bishops = MoveTargets::bishops<state>(board, pd);
+        Bitloop(bishops) if(MoveTargets::bishop(board, pd, firstBitOf(bishops))) return true;
+
+        BB rooks = MoveTargets::rooks<state>(board, pd);
+        Bitloop(rooks) if(MoveTargets::rook(board, pd, firstBitOf(rooks))) return true;
+
+        BB queens = board.queens<state.whiteToMove>();
+        Bitloop(queens) if(MoveTargets::queen(board, pd, firstBitOf(queens))) return true;
+
+        // castling is never the only legal move: it requires the king to step safely onto the neighbouring square
+        return false;
+    }
+
+    // results of the runtime entry points below, which dispatch on the state code
+    enum class Status { Ongoing, Checkmate, Stalemate };
+
+    struct StatusOf {
+        static thread_local Status status;
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            PinData pd = CheckLogicHandler::reload<state>(board);
+            if(hasLegalMove<state>(board, pd)) status = Status::Ongoing;
+            else status = isInCheck(pd) ? Status::Checkmate : Status::Stalemate;
+        }
+    };
+
+    thread_local Status StatusOf::status{Status::Ongoing};
+
+    Status status(const ExtendedBoard& eboard) {
+        Board board = eboard.board;
+        Utils::run<StatusOf, 1>(eboard.state_code, board);
+        return StatusOf::status;
+    }
+
+    bool hasLegalMove(const ExtendedBoard& eboard) {
+        return status(eboard) == Status::Ongoing;
+    }
+
+    bool isCheckmate(const ExtendedBoard& eboard) {
+        return status(eboard) == Status::Checkmate;
+    }
+
+    bool isStalemate(const ExtendedBoard& eboard) {
+        return status(eboard) == Status::Stalemate;
+    }
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_GAMESTATE_H
@@ -0,0 +1,21 @@
+//
+// Created by Robin on 18.10.2026.
+//
+
+#ifndef DORY_ISA_H
+#define DORY_ISA_H
+
+/*
+ * With runtime ISA dispatch (DORY_DISPATCH in CMake) the Dory executable contains one copy of the program per
+ * x86-64 level, each compiled with DORY_ISA set to the name of its level. Wrapping all definitions in an inline
+ * namespace of that name keeps the copies apart at link time, while the code keeps using the unqualified names.
+ */
+#ifdef DORY_ISA
+#define DORY_NAMESPACE_BEGIN inline namespace DORY_ISA {
+#define DORY_NAMESPACE_END }
+#else
+#define DORY_NAMESPACE_BEGIN
+#define DORY_NAMESPACE_END
+#endif
+
+#endif //DORY_ISA_H
@@ -0,0 +1,240 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "chess.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#endif
+
+#ifndef DORY_LARGEPAGES_H
+#define DORY_LARGEPAGES_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Allocation of big tables (hash tables, position sets) on large pages, so that random probes do not miss
+ * the TLB on nearly every access.
+ *
+ * allocate() tries explicit huge pages first (1 GB pages for tables of at least 1 GB, then 2 MB pages), which
+ * only succeeds if the administrator reserved them (vm.nr_hugepages), then asks for transparent huge pages on a
+ * 2 MB aligned mapping and finally settles for normal pages.
+ * On machines with several NUMA nodes the pages are interleaved over all nodes, so that the threads of a search
+ * share the memory bandwidth of all of them. make() constructs the elements on several threads, which places the
+ * pages by first touch if interleaving is not available.
+ */
+namespace LargePages {
+
+    enum class Pages : uint8_t { Small, Transparent, Huge2M, Huge1G };
+
+    constexpr std::array<const char*, 4> PAGE_NAMES{ "4 KB pages", "transparent huge pages", "2 MB huge pages", "1 GB huge pages" };
+
+    constexpr size_t MB = 1024 * 1024;
+    constexpr size_t HUGE_2M = 2 * MB;
+    constexpr size_t HUGE_1G = 1024 * MB;
+
+    constexpr size_t roundUp(size_t bytes, size_t alignment) {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    // what has to be known to release an allocation: the size of the mapping and how it was made
+    struct Deleter {
+        size_t bytes{0};
+        Pages pages{Pages::Small};
+
+        void operator()(void* ptr) const {
+            if(!ptr) return;
+#ifdef __linux__
+            munmap(ptr, bytes);
+#else
+            std::free(ptr);
+#endif
+        }
+    };
+
+    template<typename T>
+    using Array = std::unique_ptr<T[], Deleter>;
+
+#ifdef __linux__
+    // bit i is set if NUMA node i is online, parsed from a list like "0-3,6"
+    inline uint64_t onlineNodes() {
+        std::ifstream file{"/sys/devices/system/node/online"};
+        std::string list;
+        if(!(file >> list)) return 1;
+        uint64_t nodes = 0;
+        const char* s = list.c_str();
+        while(*s) {
+            char* end;
+            unsigned long first = std::strtoul(s, &end, 10), last = first;
+            if(end == s) break;
+            if(*end == '-') last = std::strtoul(end + 1, &end, 10);
+            for(unsigned long node = first; node <= last && node < 64; node++) nodes |= 1ull << node;
+            s = *end == ',' ? end + 1 : end;
+        }
+        return nodes ? nodes : 1;
+    }
+
+    // MPOL_INTERLEAVE over all online nodes, called before the pages are touched. numaif.h is not needed for this.
+    inline bool interleave(void* ptr, size_t bytes) {
+        constexpr int MPOL_INTERLEAVE_ = 3;
+        uint64_t nodes = onlineNodes();
+        if((nodes & (nodes - 1)) == 0) return false;
+        return syscall(SYS_mbind, ptr, bytes, MPOL_INTERLEAVE_, &nodes, 64, 0) == 0;
+    }
+
+    inline void* mapHuge(size_t bytes, int sizeFlag) {
+        void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | sizeFlag, -1, 0);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    // a normal mapping aligned to 2 MB, so that the kernel can back all of it with transparent huge pages
+    inline void* mapAligned(size_t bytes) {
+        void* raw = mmap(nullptr, bytes + HUGE_2M, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED) return nullptr;
+        auto begin = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = roundUp(begin, HUGE_2M);
+        if(aligned > begin) munmap(raw, aligned - begin);
+        if(aligned < begin + HUGE_2M) munmap(reinterpret_cast<void*>(aligned + bytes), begin + HUGE_2M - aligned);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    inline bool transparentHugePagesEnabled() {
+        std::ifstream file{"/sys/kernel/mm/transparent_hugepage/enabled"};
+        std::string setting;
+        std::getline(file, setting);
+        return setting.find("[never]") == std::string::npos && !setting.empty();
+    }
+#endif
+
+    /**
+     * Zero initialised memory of at least 'bytes' bytes, on the largest pages available if 'large'.
+     * 'deleter' receives what is needed to release the memory again.
+     */
+    inline void* allocate(size_t bytes, bool large, Deleter& deleter) {
+#ifdef __linux__
+        void* ptr = nullptr;
+        if(large && bytes >= HUGE_1G && (ptr = mapHuge(deleter.bytes = roundUp(bytes, HUGE_1G), 30 << MAP_HUGE_SHIFT)))
+            deleter.pages = Pages::Huge1G;
+        else if(large && bytes >= HUGE_2M && (ptr = mapHuge(deleter.bytes = roundUp(bytes, HUGE_2M), 21 << MAP_HUGE_SHIFT)))
+            deleter.pages = Pages::Huge2M;
+        else if(large && bytes >= HUGE_2M && (ptr = mapAligned(deleter.bytes = roundUp(bytes, HUGE_2M)))) {
+            deleter.pages = madvise(ptr, deleter.bytes, MADV_HUGEPAGE) == 0 && transparentHugePagesEnabled()
+                            ? Pages::Transparent : Pages::Small;
+        } else {
+            void* raw = mmap(nullptr, deleter.bytes = bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            ptr = raw == MAP_FAILED ? nullptr : raw;
+            deleter.pages = Pages::Small;
+        }
+        if(!ptr) throw std::bad_alloc();
+        interleave(ptr, deleter.bytes);
+        return ptr;
+#else
+        (void) large;
+        deleter = { bytes, Pages::Small };
+        void* ptr = std::aligned_alloc(64, roundUp(bytes, 64));
+        if(!ptr) throw std::bad_alloc();
+        return ptr;
+#endif
+    }
+
+    /**
+     * An array of 'count' default constructed elements. The construction is split over 'threads' threads,
+     * so that with first touch placement each thread's share of the table ends up on its own NUMA node.
+     */
+    template<typename T>
+    Array<T> make(size_t count, bool large = true, unsigned threads = 1) {
+        static_assert(std::is_trivially_destructible_v<T>, "the elements are released without calling destructors");
+        Deleter deleter;
+        T* elements = static_cast<T*>(allocate(count * sizeof(T), large, deleter));
+
+        auto construct = [&](unsigned id) {
+            size_t first = count * id / threads, last = count * (id + 1) / threads;
+            for(size_t i = first; i < last; i++) new (&elements[i]) T{};
+        };
+        std::vector<std::thread> helpers;
+        for(unsigned id = 1; id < threads; id++) helpers.emplace_back(construct, id);
+        construct(0);
+        for(std::thread& helper: helpers) helper.join();
+
+        return Array<T>{ elements, deleter };
+    }
+
+    /**
+     * Counts the data TLB read misses of the calling thread and of all threads it starts while counting, through
+     * perf_event_open. Unavailable without Linux, without a PMU (many virtual machines) or if
+     * kernel.perf_event_paranoid forbids it, in which case stop() returns nothing.
+     */
+    class TLBMissCounter {
+        int fd{-1};
+
+    public:
+        TLBMissCounter() {
+#ifdef __linux__
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~TLBMissCounter() {
+#ifdef __linux__
+            if(fd >= 0) close(fd);
+#endif
+        }
+
+        TLBMissCounter(const TLBMissCounter&) = delete;
+        TLBMissCounter& operator=(const TLBMissCounter&) = delete;
+
+        [[nodiscard]] bool available() const {
+            return fd >= 0;
+        }
+
+        void start() {
+#ifdef __linux__
+            if(fd < 0) return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        std::optional<uint64_t> stop() {
+#ifdef __linux__
+            uint64_t misses;
+            if(fd < 0) return std::nullopt;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if(read(fd, &misses, sizeof(misses)) == sizeof(misses)) return misses;
+#endif
+            return std::nullopt;
+        }
+    };
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_LARGEPAGES_H
@@ -1,33 +1,520 @@
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 
 #include "movecollectors.h"
 #include "fenreader.h"
+#include "largepages.h"
+#include "moveiterator.h"
+#include "pgn.h"
+#include "polyglot.h"
+#include "search.h"
+#include "see.h"
+#include "tablebase.h"
+
+DORY_NAMESPACE_BEGIN
 
 using Collector = MoveCollectors::LimitedDFS<false, false>;
+using MakeUnmakeCollector = MoveCollectors::LimitedDFS<false, false, MovePolicy::MakeUnmake>;
+using ProfilingCollector = MoveCollectors::LimitedDFS<false, false, MovePolicy::CopyMake, true>;
 
+template<typename C>
 struct Runner {
     template<State state, int depth>
     static void main(Board& board) {
-        Utils::time_movegen<Collector, state, depth>(board);
+        Utils::time_movegen<C, state, depth>(board);
     }
 };
 
-int main(int argc, char* argv[]) {
+struct ProfileRunner {
+    template<State state, int depth>
+    static void main(Board& board) {
+        Profiling::reset();
+        Utils::time_movegen<ProfilingCollector, state, depth>(board);
+        Profiling::print(depth);
+    }
+};
+
+struct DivideRunner {
+    template<State state, int depth>
+    static void main(Board& board) {
+        MoveCollectors::Divide::generateGameTree<state, depth>(board);
+        MoveCollectors::Divide::print();
+    }
+};
+
+ExtendedBoard rootPosition(std::string_view fen) {
+    if (fen == "startpos" || fen == "start") return { STARTBOARD, getStateCode<STARTSTATE>() };
+    return Utils::parseFEN(fen);
+}
+
+// All positions up to the given depth, transpositions included
+std::vector<ExtendedBoard> collectPositions(std::string_view fen, int depth) {
+    std::vector<ExtendedBoard> positions{rootPosition(fen)};
+    size_t begin = 0;
+    for (int ply = 0; ply < depth; ply++) {
+        size_t end = positions.size();
+        for (size_t i = begin; i < end; i++) {
+            MoveCollectors::SuccessorBoards::getLegalMoves(positions.at(i));
+            for (const ExtendedBoard& successor: MoveCollectors::SuccessorBoards::positions)
+                positions.push_back(successor);
+        }
+        begin = end;
+    }
+    return positions;
+}
+
+// Round trips all positions up to the given depth through toFEN / parseFEN
+void fenBenchmark(std::string_view fen, int depth) {
+    Utils::time_fen_roundtrip(collectPositions(fen, depth), 10);
+}
+
+template<typename SliderKernel>
+struct ReloadRunner {
+    static inline BB checksum{0};
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        checksum += CheckLogicHandler::reload<state, SliderKernel>(board).attacked;
+    }
+};
+
+template<typename SliderKernel>
+void timeReload(const char* name, std::vector<ExtendedBoard>& positions, int rounds) {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (ExtendedBoard& eboard: positions)
+            Utils::run<ReloadRunner<SliderKernel>, 1>(eboard.state_code, eboard.board);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> seconds = t2 - t1;
+    double total = static_cast<double>(positions.size()) * rounds;
+    std::cout << name << ": " << (total / 1000000) / seconds.count() << " M reloads/s (checksum "
+              << std::hex << ReloadRunner<SliderKernel>::checksum << std::dec << ")\n";
+}
+
+// Compares the slider attack kernels of CheckLogicHandler::reload on all positions up to the given depth
+void attackBenchmark(std::string_view fen, int depth) {
+    std::vector<ExtendedBoard> positions = collectPositions(fen, depth);
+    std::cout << "Reloading " << positions.size() << " positions\n";
+    timeReload<SliderAttacks::PerPiece>("per piece         ", positions, 10);
+    timeReload<SliderAttacks::KoggeStone>("Kogge-Stone scalar", positions, 10);
+#ifdef __AVX2__
+    timeReload<SliderAttacks::KoggeStoneAVX2>("Kogge-Stone AVX2  ", positions, 10);
+#endif
+#ifdef __AVX512F__
+    timeReload<SliderAttacks::KoggeStoneAVX512>("Kogge-Stone AVX512", positions, 10);
+#endif
+    std::cout << std::endl;
+}
+
+// Counts legal moves through the callback interface of MoveGenerator. The target squares are hashed as well,
+// otherwise the compiler turns counting the bits of the target sets into a popcount.
+template<bool captures = false>
+struct MoveCounter {
+    static constexpr bool capturesOnly = captures;
+    static inline unsigned long long moves{0};
+    static inline BB checksum{0};
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        MoveGenerator<MoveCounter>::template generate<state, 1>(board);
+    }
+
+    template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+    static void registerMove([[maybe_unused]] const Board& board, BB from, BB to) {
+        moves++;
+        checksum = (checksum ^ from ^ to) * 0x9e3779b97f4a7c15;
+    }
+
+    template<State nextState, int depth>
+    static void next([[maybe_unused]] Board& nextBoard) {}
+};
+
+// Counts legal moves with MoveIterator, optionally stopping after the first one
+template<bool firstOnly>
+struct IteratorCounter {
+    static inline unsigned long long moves{0};
+    static inline BB checksum{0};
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        MoveIterator<state> it{board};
+        Move move;
+        while(it.next(move)) {
+            moves++;
+            checksum = (checksum ^ move.from ^ move.to) * 0x9e3779b97f4a7c15;
+            if constexpr (firstOnly) break;
+        }
+    }
+};
+
+template<typename Counter>
+void timeMoveCounter(const char* name, std::vector<ExtendedBoard>& positions, int rounds) {
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (ExtendedBoard& eboard: positions)
+            Utils::run<Counter, 1>(eboard.state_code, eboard.board);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> seconds = t2 - t1;
+    double total = static_cast<double>(positions.size()) * rounds;
+    std::cout << name << ": " << (total / 1000000) / seconds.count() << " M positions/s, "
+              << Counter::moves / rounds << " moves\n";
+}
+
+// Compares generating all moves by callback and by iterator, and stopping the iterator after the first move.
+// Generating only the captures (as for a quiescence search) is listed as well.
+void iteratorBenchmark(std::string_view fen, int depth) {
+    std::vector<ExtendedBoard> positions = collectPositions(fen, depth);
+    std::cout << "Generating moves of " << positions.size() << " positions\n";
+    timeMoveCounter<MoveCounter<>>("callback          ", positions, 10);
+    timeMoveCounter<MoveCounter<true>>("callback, captures", positions, 10);
+    timeMoveCounter<IteratorCounter<false>>("iterator          ", positions, 10);
+    timeMoveCounter<IteratorCounter<true>>("iterator, 1 move  ", positions, 10);
+    std::cout << std::endl;
+}
+
+struct Capture {
+    Board board;
+    BB from, to;
+    Flag_t flags;
+    bool white;
+};
+
+// Collects the captures of a position with MoveIterator
+struct CaptureCollector {
+    static inline std::vector<Capture> captures;
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        MoveIterator<state> it{board};
+        Move move;
+        while(it.next(move)) {
+            if((move.to & board.enemyPieces<state.whiteToMove>()) || move.flags == MoveFlag::EnPassantCapture)
+                captures.push_back({ board, move.from, move.to, move.flags, state.whiteToMove });
+        }
+    }
+};
+
+// Evaluates all captures of all positions up to the given depth with SEE
+void seeBenchmark(std::string_view fen, int depth) {
+    std::vector<ExtendedBoard> positions = collectPositions(fen, depth);
+    CaptureCollector::captures.clear();
+    for (ExtendedBoard& eboard: positions) Utils::run<CaptureCollector, 1>(eboard.state_code, eboard.board);
+    const std::vector<Capture>& captures = CaptureCollector::captures;
+
+    const int rounds = 10;
+    long long sum = 0, winning = 0;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const Capture& c: captures) {
+            int value = c.white ? SEE::evaluate<true>(c.board, c.from, c.to, c.flags)
+                                : SEE::evaluate<false>(c.board, c.from, c.to, c.flags);
+            sum += value;
+            winning += value > 0;
+        }
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double, std::nano> nanos = t2 - t1;
+    double total = static_cast<double>(captures.size()) * rounds;
+    std::cout << "Evaluated " << captures.size() << " captures of " << positions.size() << " positions, "
+              << winning / rounds << " winning (checksum " << sum << ")\n";
+    std::cout << (captures.empty() ? 0.0 : nanos.count() / total) << " ns per SEE\n" << std::endl;
+}
+
+// Iterative deepening with and without move ordering, the scores have to agree, the node counts show the gain
+void searchComparison(std::string_view fen, int depth) {
+    ExtendedBoard root = rootPosition(fen);
+    Search::AlphaBeta::clear();
+    unsigned long long totalOrdered = 0, totalUnordered = 0;
+    char name[6];
+    for (int d = 1; d <= depth; d++) {
+        Search::Result unordered = Search::AlphaBeta::search(root, d, false);
+        Search::Result ordered = Search::AlphaBeta::search(root, d, true);
+        totalUnordered += unordered.nodes;
+        totalOrdered += ordered.nodes;
+        Utils::uciMove(ordered.best, name);
+        std::cout << "depth " << d << ": score " << ordered.score << " best " << name
+                  << ", nodes " << unordered.nodes << " unordered, " << ordered.nodes << " ordered ("
+                  << ordered.qnodes << " in quiescence)"
+                  << (ordered.score != unordered.score ? " (score mismatch!)" : "") << "\n";
+    }
+    std::cout << "Total nodes: " << totalUnordered << " unordered, " << totalOrdered << " ordered ("
+              << 100.0 * static_cast<double>(totalOrdered) / static_cast<double>(totalUnordered) << "%)\n" << std::endl;
+}
+
+// Time to depth of the Lazy SMP search for 1, 2, 4, ... threads, each run starting from an empty table
+void smpScaling(std::string_view fen, int depth, unsigned maxThreads, size_t hashMB) {
+    ExtendedBoard root = rootPosition(fen);
+    TranspositionTable table{hashMB};
+    double base = 0;
+    char name[6];
+    std::cout << "Hash: " << hashMB << " MB on " << LargePages::PAGE_NAMES[static_cast<int>(table.pages())] << "\n";
+    std::cout << "threads      time     nodes/s   speedup  score  best\n";
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        table.clear(threads);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        Search::Result result = Search::LazySMP::search(root, depth, threads, table);
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double> seconds = t2 - t1;
+        if (threads == 1) base = seconds.count();
+        Utils::uciMove(result.best, name);
+        std::printf("%7u %8.3fs %10.2fM %8.2fx %6d  %s\n", threads, seconds.count(),
+                    static_cast<double>(result.nodes) / 1000000 / seconds.count(), base / seconds.count(), result.score, name);
+    }
+    std::cout << std::endl;
+}
+
+std::string formatMisses(std::optional<uint64_t> misses) {
+    return misses ? std::to_string(*misses) : "n/a";
+}
+
+// Random stores and probes and a Lazy SMP search on a table with normal pages and on one with large pages,
+// with the data TLB misses of both if the CPU and the kernel allow counting them
+void hashBenchmark(std::string_view fen, int depth, size_t hashMB) {
+    ExtendedBoard root = rootPosition(fen);
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    LargePages::TLBMissCounter counter;
+    std::cout << "Hash: " << hashMB << " MB, search with " << threads << " threads\n";
+    std::printf("%-24s %12s %16s %10s %16s\n", "pages", "ns/probe", "probe dTLB miss", "search", "search dTLB miss");
+    for (bool large: { false, true }) {
+        TranspositionTable table{hashMB, large};
+        table.clear(threads);
+        const size_t probes = 4 * table.size();
+        uint64_t key = 0;
+
+        counter.start();
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < probes; i++) {
+            key = (key + 0x9e3779b97f4a7c15) * 0xbf58476d1ce4e5b9;
+            TranspositionTable::Data data;
+            if (!table.probe(key, data)) table.store(key, { 0, 0, static_cast<uint8_t>(i), TranspositionTable::Exact });
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::optional<uint64_t> probeMisses = counter.stop();
+
+        counter.start();
+        auto t3 = std::chrono::high_resolution_clock::now();
+        Search::LazySMP::search(root, depth, threads, table);
+        auto t4 = std::chrono::high_resolution_clock::now();
+        std::optional<uint64_t> searchMisses = counter.stop();
+
+        std::chrono::duration<double, std::nano> probeNanos = t2 - t1;
+        std::chrono::duration<double> searchSeconds = t4 - t3;
+        std::printf("%-24s %12.2f %16s %9.3fs %16s\n", LargePages::PAGE_NAMES[static_cast<int>(table.pages())],
+                    probeNanos.count() / static_cast<double>(probes), formatMisses(probeMisses).c_str(),
+                    searchSeconds.count(), formatMisses(searchMisses).c_str());
+    }
+    std::cout << std::endl;
+}
+
+// The Polyglot key of the position and its moves in the book
+void bookMoves(std::string_view fen, const std::string& bookPath, const std::string& randomsPath) {
+    ExtendedBoard root = rootPosition(fen);
+    Polyglot::Randoms randoms = Polyglot::loadRandoms(randomsPath);
+    if (Polyglot::hash(randoms, STARTBOARD, getStateCode<STARTSTATE>()) != Polyglot::START_KEY)
+        std::cout << "Warning: " << randomsPath << " is not the Polyglot Random64 array, the keys will not match the book\n";
+
+    Polyglot::Book book{bookPath};
+    std::printf("%zu entries, key %016llx\n", book.size(),
+                static_cast<unsigned long long>(Polyglot::hash(randoms, root.board, root.state_code)));
+    char name[6];
+    for (const Polyglot::BookMove& move: book.moves(randoms, root)) {
+        Utils::uciMove(move.move, name);
+        std::printf("%-6s %6u\n", name, move.weight);
+    }
+    std::cout << std::endl;
+}
+
+// Builds the endgame tablebase of the position's material (and the ones it depends on) and probes the position
+void tablebase(std::string_view fen, const std::string& dir, unsigned threads) {
+    ExtendedBoard root = rootPosition(fen);
+    Tablebase::Generator generator{dir, threads};
+    for (const Tablebase::Stats& stats: generator.build(Tablebase::Material::of(root.board).name()))
+        std::printf("%-8s %12llu positions %12llu wins %12llu losses %12llu draws, longest mate %3d plies, %.2f s\n",
+                    stats.name.c_str(), static_cast<unsigned long long>(stats.positions), static_cast<unsigned long long>(stats.wins),
+                    static_cast<unsigned long long>(stats.losses), static_cast<unsigned long long>(stats.draws), stats.longest, stats.seconds);
+
+    constexpr std::array<const char*, 4> WDL_NAMES{ "draw", "win", "loss", "invalid" };
+    std::optional<Tablebase::Result> result = generator.tablebases().probe(root.board, root.state_code);
+    if (!result) std::cout << "Not in the tablebases (castling rights or en passant)" << std::endl;
+    else if (result->wdl == Tablebase::Draw || result->wdl == Tablebase::Invalid) std::cout << WDL_NAMES[result->wdl] << std::endl;
+    else std::cout << WDL_NAMES[result->wdl] << ", mate in " << result->dtm << " plies" << std::endl;
+}
+
+// Replays all games of a PGN file, decoding every move against the legal moves of its position
+void replayGames(const std::string& path, unsigned threads) {
+    PGN::Reader reader{path};
+    std::vector<uint64_t> checks(std::max(1u, threads));
+    PGN::Stats stats = reader.replay(threads, [&](unsigned thread, const PGN::Game&, const ExtendedBoard& position, PackedMove, int) {
+        checks[thread] += PGN::isInCheck(position);
+    });
+
+    uint64_t totalChecks = 0;
+    for (uint64_t c: checks) totalChecks += c;
+    std::printf("%llu games, %llu positions (%llu in check) in %.3f s with %u threads\n",
+                static_cast<unsigned long long>(stats.games), static_cast<unsigned long long>(stats.positions),
+                static_cast<unsigned long long>(totalChecks), stats.seconds, std::max(1u, threads));
+    std::printf("%.0f games/s, %.0f positions/s, %.1f MB/s\n", static_cast<double>(stats.games) / stats.seconds,
+                static_cast<double>(stats.positions) / stats.seconds, static_cast<double>(reader.text().size()) / 1e6 / stats.seconds);
+    if (stats.errors > 0)
+        std::printf("%llu games could not be replayed, the first at byte %zu stops at '%s'\n",
+                    static_cast<unsigned long long>(stats.errors), stats.errorOffset, stats.errorToken.c_str());
+}
+
+int runDory(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cerr << R"(Usage: ./Dory "<FEN>" <Depth>)" << std::endl;
+        std::cerr << R"(Usage: ./Dory "<FEN>" <Depth> [--divide | --unmake | --profile | --fen-bench | --attack-bench | --iter-bench | --see-bench | --search | --smp [threads] | --hash-bench | --book <book.bin> <random64.txt> | --tablebase <dir> [threads] | --pgn <file> [threads]] [--hash MB])" << std::endl;
         return 1;
     }
 
     std::string_view fen{argv[1]};
     int depth = static_cast<int>(std::strtol(argv[2], nullptr, 10));
 
+    // the mode and its arguments, '--hash MB' may appear anywhere after the depth
+    std::string_view mode;
+    std::vector<std::string> modeArgs;
+    size_t hashMB = 64;
+    for (int i = 3; i < argc; i++) {
+        std::string_view arg{argv[i]};
+        if (arg == "--hash" && i + 1 < argc) hashMB = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if (mode.empty()) mode = arg;
+        else modeArgs.emplace_back(arg);
+    }
+
     PieceSteps::load();
 
+    if (mode == "--fen-bench") {
+        try {
+            fenBenchmark(fen, depth);
+        } catch (std::exception& ex) {
+            std::cerr << "Invalid FEN string!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (mode == "--smp" || mode == "--hash-bench") {
+        unsigned threads = !modeArgs.empty() ? static_cast<unsigned>(std::strtoul(modeArgs[0].c_str(), nullptr, 10))
+                                             : std::max(1u, std::thread::hardware_concurrency());
+        try {
+            if (mode == "--smp") smpScaling(fen, depth, std::max(1u, threads), hashMB);
+            else hashBenchmark(fen, depth, hashMB);
+        } catch (std::bad_alloc& ex) {
+            std::cerr << "Could not allocate " << hashMB << " MB for the hash table!" << std::endl;
+            return 1;
+        } catch (std::exception& ex) {
+            std::cerr << "Invalid FEN string!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (mode == "--book") {
+        if (modeArgs.size() < 2) {
+            std::cerr << "--book needs the book and a file with the Polyglot Random64 array" << std::endl;
+            return 1;
+        }
+        try {
+            bookMoves(fen, modeArgs[0], modeArgs[1]);
+        } catch (std::runtime_error& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 1;
+        } catch (std::exception& ex) {
+            std::cerr << "Invalid FEN string!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (mode == "--pgn") {
+        if (modeArgs.empty()) {
+            std::cerr << "--pgn needs a PGN file" << std::endl;
+            return 1;
+        }
+        unsigned threads = modeArgs.size() > 1 ? static_cast<unsigned>(std::strtoul(modeArgs[1].c_str(), nullptr, 10))
+                                               : std::thread::hardware_concurrency();
+        try {
+            replayGames(modeArgs[0], threads);
+        } catch (std::runtime_error& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (mode == "--tablebase") {
+        if (modeArgs.empty()) {
+            std::cerr << "--tablebase needs the directory of the tables" << std::endl;
+            return 1;
+        }
+        unsigned threads = modeArgs.size() > 1 ? static_cast<unsigned>(std::strtoul(modeArgs[1].c_str(), nullptr, 10))
+                                               : std::thread::hardware_concurrency();
+        try {
+            tablebase(fen, modeArgs[0], threads);
+        } catch (std::bad_alloc&) {
+            std::cerr << "Not enough memory for the tablebase" << std::endl;
+            return 1;
+        } catch (std::invalid_argument& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 1;
+        } catch (std::runtime_error& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 1;
+        } catch (std::exception& ex) {
+            std::cerr << "Invalid FEN string!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (mode == "--attack-bench" || mode == "--iter-bench" || mode == "--see-bench" || mode == "--search") {
+        try {
+            if (mode == "--attack-bench") attackBenchmark(fen, depth);
+            else if (mode == "--iter-bench") iteratorBenchmark(fen, depth);
+            else if (mode == "--see-bench") seeBenchmark(fen, depth);
+            else searchComparison(fen, depth);
+        } catch (std::exception& ex) {
+            std::cerr << "Invalid FEN string!" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (mode == "--divide") {
+        if (fen == "startpos" || fen == "start") Utils::startingPositionAtDepth<DivideRunner>(depth);
+        else Utils::loadFEN<DivideRunner>(fen, depth);
+        return 0;
+    }
+
+    if (mode == "--unmake") {
+        if (fen == "startpos" || fen == "start") Utils::startingPositionAtDepth<Runner<MakeUnmakeCollector>>(depth);
+        else Utils::loadFEN<Runner<MakeUnmakeCollector>>(fen, depth);
+        return 0;
+    }
+
+    if (mode == "--profile") {
+        if (fen == "startpos" || fen == "start") Utils::startingPositionAtDepth<ProfileRunner>(depth);
+        else Utils::loadFEN<ProfileRunner>(fen, depth);
+        return 0;
+    }
+
     if (fen == "startpos" || fen == "start") {
-        Utils::startingPositionAtDepth<Runner>(depth);
+        Utils::startingPositionAtDepth<Runner<Collector>>(depth);
     } else {
-        Utils::loadFEN<Runner>(fen, depth);
+        Utils::loadFEN<Runner<Collector>>(fen, depth);
     }
 
     return 0;
 }
+
+DORY_NAMESPACE_END
+
+#ifndef DORY_ISA
+int main(int argc, char* argv[]) {
+    return runDory(argc, argv);
+}
+#endif
@@ -0,0 +1,90 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "chess.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef DORY_MAPPEDFILE_H
+#define DORY_MAPPEDFILE_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * A file mapped into memory read-only, for lookups in big files (opening books, tablebases) that should only
+ * read the pages they touch instead of loading the whole file.
+ */
+class MappedFile {
+    const unsigned char* bytes{nullptr};
+    size_t length{0};
+
+public:
+    MappedFile() = default;
+
+    // throws std::runtime_error if the file cannot be mapped. 'random' tells the kernel not to read ahead.
+    explicit MappedFile(const std::string& path, bool random = true) {
+#ifdef __linux__
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) throw std::runtime_error("cannot open " + path);
+        struct stat info{};
+        if(fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot read " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if(length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if(mapped == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            if(random) madvise(mapped, length, MADV_RANDOM);
+            bytes = static_cast<const unsigned char*>(mapped);
+        }
+        close(fd);
+#else
+        (void) random;
+        throw std::runtime_error("memory mapped files need Linux, cannot map " + path);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef __linux__
+        if(bytes) munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : bytes{std::exchange(other.bytes, nullptr)}, length{std::exchange(other.length, 0)} {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const unsigned char* data() const {
+        return bytes;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return length;
+    }
+};
+
+DORY_NAMESPACE_END
+
+#endif //DORY_MAPPEDFILE_H
@@ -7,10 +7,15 @@
 
 #include <unordered_map>
 #include <vector>
+#include <array>
+#include <atomic>
+#include <thread>
 #include "movegen.h"
 #include "utils.h"
 #include "fenreader.h"
 
+DORY_NAMESPACE_BEGIN
+
 /**
  * A namespace containing various classes for collecting the moves generated by movegen.
  */
@@ -21,10 +26,13 @@ namespace MoveCollectors {
      *
      * @tparam saveBoards - whether resulting boards at lowest level should be saved in 'positions'
      * @tparam print - whether moves should be printed to stdout. Only recommended for very small depths
+     * @tparam Policy - whether successor boards are copied (MovePolicy::CopyMake) or played in place (MovePolicy::MakeUnmake)
+     * @tparam profiled - whether the stages of move generation are timed, see profiling.h
      */
-    template<bool saveBoards, bool print>
+    template<bool saveBoards, bool print, typename Policy = MovePolicy::CopyMake, bool profiled = false>
     class LimitedDFS {
     public:
+        static constexpr bool profile = profiled;
         static unsigned long long totalNodes;
         static std::vector<Board> positions;
 
@@ -41,7 +49,7 @@ namespace MoveCollectors {
         template<State state, int depth>
         static void build(Board& board) {
             if constexpr (depth > 0) {
-                MoveGenerator<LimitedDFS<saveBoards, print>>::template generate<state, depth>(board);
+                MoveGenerator<LimitedDFS<saveBoards, print, Policy, profiled>, Policy>::template generate<state, depth>(board);
             }
         }
 
@@ -64,13 +72,13 @@ namespace MoveCollectors {
             build<nextState, depth-1>(nextBoard);
         }
 
-        friend class MoveGenerator<LimitedDFS<saveBoards, print>>;
+        friend class MoveGenerator<LimitedDFS<saveBoards, print, Policy, profiled>, Policy>;
     };
 
-    template<bool saveList, bool print>
-    unsigned long long LimitedDFS<saveList, print>::totalNodes{0};
-    template<bool saveList, bool print>
-    std::vector<Board> LimitedDFS<saveList, print>::positions{};
+    template<bool saveList, bool print, typename Policy, bool profiled>
+    unsigned long long LimitedDFS<saveList, print, Policy, profiled>::totalNodes{0};
+    template<bool saveList, bool print, typename Policy, bool profiled>
+    std::vector<Board> LimitedDFS<saveList, print, Policy, profiled>::positions{};
 
 
     /**
@@ -97,12 +105,12 @@ namespace MoveCollectors {
 
     private:
         template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
-        static void registerMove(Board &board, [[maybe_unused]] BB from, [[maybe_unused]] BB to) {
-            positions.push_back(getExtendedBoard<state>(board));
-        }
+        static void registerMove([[maybe_unused]] Board &board, [[maybe_unused]] BB from, [[maybe_unused]] BB to) {}
 
         template<State nextState, int depth>
-        static void next([[maybe_unused]] Board& nextBoard) {}
+        static void next(Board& nextBoard) {
+            positions.push_back(getExtendedBoard<nextState>(nextBoard));
+        }
 
         friend class MoveGenerator<SuccessorBoards>;
     };
@@ -150,65 +158,112 @@ namespace MoveCollectors {
     /**
      * A Movecollector for listing the divide output for a given position.
      * For every legal move the number of resulting follow-up positions at the given depth is calculated.
+     * The subtrees of the root moves are counted in parallel on 'threads' threads.
      * Used mainly for debugging purposes.
      */
     class Divide {
     public:
-        static std::vector<std::string> moves;
-        static std::vector<uint64_t> nodes;
+        static std::array<PackedMove, MAX_MOVES> moves;
+        static std::array<unsigned long long, MAX_MOVES> nodes;
         static unsigned long long curr, totalNodes;
-        static int maxDepth;
+        static unsigned threads;
 
         template<State state, int depth>
         static void generateGameTree(Board& board) {
-            maxDepth = depth;
-            build<state, depth>(board);
+            curr = 0;
+            totalNodes = 0;
+            if constexpr (depth > 0) {
+                MoveGenerator<Divide>::template generate<state, depth>(board);
+            }
+
+            std::atomic<unsigned long long> nextSubtree{0};
+            auto worker = [&nextSubtree]() {
+                for(unsigned long long i; (i = nextSubtree.fetch_add(1, std::memory_order_relaxed)) < curr;) {
+                    nodes[i] = subtrees[i].count(subtrees[i].board);
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for(unsigned t = 1; t < std::min<unsigned long long>(threads, curr); t++) pool.emplace_back(worker);
+            worker();
+            for(std::thread& thread: pool) thread.join();
+
+            for(unsigned long long i{0}; i < curr; i++) totalNodes += nodes[i];
         }
 
         static void print() {
-            for(unsigned int i{0}; i < curr; i++) {
-                std::cout << moves.at(i) << ": " << nodes.at(i) << std::endl;
+            char name[6];
+            for(unsigned long long i{0}; i < curr; i++) {
+                Utils::uciMove(moves[i], name);
+                std::cout << name << ": " << nodes[i] << "\n";
             }
 
             std::cout << "\nTotal nodes searched: " << totalNodes << std::endl;
         }
 
     private:
-        template<State state, int depth>
-        static void build(Board& board) {
-            if constexpr (depth > 0) {
-                MoveGenerator<Divide>::template generate<state, depth>(board);
+        struct Subtree {
+            Board board;
+            unsigned long long (*count)(Board&);
+        };
+        static std::array<Subtree, MAX_MOVES> subtrees;
+
+        /**
+         * Counts the leaves below a root move, only ever called from the worker threads.
+         */
+        class SubtreeCounter {
+            static thread_local unsigned long long leaves;
+
+        public:
+            template<State state, int depth>
+            static unsigned long long count(Board& board) {
+                if constexpr (depth == 0) return 1;
+                else {
+                    leaves = 0;
+                    MoveGenerator<SubtreeCounter>::template generate<state, depth>(board);
+                    return leaves;
+                }
             }
-        }
 
-        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
-        static void registerMove([[maybe_unused]] const Board &board, BB from, BB to) {
-            if (depth == maxDepth) {
-                Move m{from, to, piece, flags};
-                moves.push_back(Utils::moveNameShort<state.whiteToMove>(m));
-                nodes.push_back(0);
-                curr++;
+        private:
+            template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+            static void registerMove([[maybe_unused]] const Board &board, [[maybe_unused]] BB from, [[maybe_unused]] BB to) {
+                if constexpr (depth == 1) leaves++;
             }
 
-            if constexpr(depth == 1) {
-                nodes.back()++;
-                totalNodes++;
+            template<State nextState, int depth>
+            static void next(Board& nextBoard) {
+                if constexpr (depth > 1) {
+                    MoveGenerator<SubtreeCounter>::template generate<nextState, depth-1>(nextBoard);
+                }
             }
+
+            friend class MoveGenerator<SubtreeCounter>;
+        };
+
+        // Divide itself only ever sees the root moves, deeper plies are handled by SubtreeCounter
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove([[maybe_unused]] const Board &board, BB from, BB to) {
+            moves[curr] = packMove(from, to, flags);
         }
 
         template<State nextState, int depth>
         static void next(Board& nextBoard) {
-            build<nextState, depth-1>(nextBoard);
+            subtrees[curr++] = { nextBoard, &SubtreeCounter::template count<nextState, depth-1> };
         }
 
         friend class MoveGenerator<Divide>;
     };
 
-    std::vector<std::string> Divide::moves{};
-    std::vector<uint64_t> Divide::nodes{};
+    std::array<PackedMove, MAX_MOVES> Divide::moves{};
+    std::array<unsigned long long, MAX_MOVES> Divide::nodes{};
+    std::array<Divide::Subtree, MAX_MOVES> Divide::subtrees{};
     unsigned long long Divide::curr{0};
     unsigned long long Divide::totalNodes{0};
-    int Divide::maxDepth{1};
+    unsigned Divide::threads{std::max(1u, std::thread::hardware_concurrency())};
+    thread_local unsigned long long Divide::SubtreeCounter::leaves{0};
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_MOVECOLLECTORS_H
@@ -2,13 +2,170 @@
 // Created by Robin on 01.07.2022.
 //
 
+#include <type_traits>
 #include "checklogichandler.h"
+#include "profiling.h"
 
 #ifndef DORY_MOVEGEN_H
 #define DORY_MOVEGEN_H
 
-template<typename>
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Strategies for producing the board handed to the collector in 'next'.
+ * CopyMake creates a new board for every move (see Board::getNextBoard), MakeUnmake plays the move on
+ * the current board and takes it back once the collector returns (see Board::makeMove).
+ */
+namespace MovePolicy {
+    struct CopyMake {};
+    struct MakeUnmake {};
+}
+
+/**
+ * Legal targets of the individual pieces, shared by MoveGenerator and MoveIterator.
+ * The functions taking a square return the target squares of the piece on it, the others the pieces that can move.
+ */
+namespace MoveTargets {
+
+    // pawns that can make the respective move, the promoting pawns are kept in separate sets
+    struct Pawns {
+        BB push{0}, captureLeft{0}, captureRight{0};
+        BB promotePush{0}, promoteLeft{0}, promoteRight{0};
+        BB doublePush{0}, epLeft{0}, epRight{0};
+    };
+
+    template<State state>
+    Pawns pawns(const Board& board, const PinData& pd) {
+        constexpr bool white = state.whiteToMove;
+        Pawns p;
+        BB free = board.free();
+        BB enemy = board.enemyPieces<white>();
+        BB pawnsFwd = board.pawns<white>() & ~pd.pinsDiag;
+        BB pawnCapt = board.pawns<white>() & ~pd.pinsStr;
+
+        // pawns that can move 1 or 2 squares
+        BB pwnMov = pawnsFwd & backward<white>(free);
+        p.doublePush = pwnMov & backward2<white>(free & pd.checkMask) & firstRank<white>();
+        pwnMov &= backward<white>(pd.checkMask);
+
+        // pawns that can capture Left or Right
+        BB pawnCapL = pawnCapt & pawnInvAtkLeft<white>(enemy & pd.checkMask) & pawnCanGoLeft<white>();
+        BB pawnCapR = pawnCapt & pawnInvAtkRight<white>(enemy & pd.checkMask) & pawnCanGoRight<white>();
+
+        // remove pinned pawns
+        pwnMov          &= backward<white> (pd.pinsStr) | ~pd.pinsStr;
+        p.doublePush    &= backward2<white>(pd.pinsStr) | ~pd.pinsStr;
+        pawnCapL        &= pawnInvAtkLeft<white> (pd.pinsDiag & pawnCanGoRight<white>()) | ~pd.pinsDiag;
+        pawnCapR        &= pawnInvAtkRight<white>(pd.pinsDiag & pawnCanGoLeft <white>()) | ~pd.pinsDiag;
+
+        // handle en passant pawns
+        BB enPassant = board.enPassantField;
+        if(enPassant != 0 && !pd.blockEP) {
+            // left capture is ep square and is on checkmask
+            p.epLeft = pawnCapt & pawnCanGoLeft<white>() & pawnInvAtkLeft<white>(enPassant & forward<white>(pd.checkMask));
+            // remove pinned ep pawns
+            p.epLeft &= pawnInvAtkLeft<white>(pd.pinsDiag & pawnCanGoLeft<white>()) | ~pd.pinsDiag;
+
+            // right capture is ep square and is on checkmask
+            p.epRight = pawnCapt & pawnCanGoRight<white>() & pawnInvAtkRight<white>(enPassant & forward<white>(pd.checkMask));
+            // remove pinned ep pawns
+            p.epRight &= pawnInvAtkRight<white>(pd.pinsDiag & pawnCanGoRight<white>()) | ~pd.pinsDiag;
+        }
+
+        // split off the promoting pawns
+        BB lastRowMask  = pawnOnLastRow<white>();
+        p.promotePush   = pwnMov   & lastRowMask;
+        p.promoteLeft   = pawnCapL & lastRowMask;
+        p.promoteRight  = pawnCapR & lastRowMask;
+        p.push          = pwnMov   & ~lastRowMask;
+        p.captureLeft   = pawnCapL & ~lastRowMask;
+        p.captureRight  = pawnCapR & ~lastRowMask;
+        return p;
+    }
+
+    template<State state>
+    BB knights(const Board& board, const PinData& pd) {
+        return board.knights<state.whiteToMove>() & ~(pd.pinsStr | pd.pinsDiag);
+    }
+
+    inline BB knight(const PinData& pd, int ix) {
+        return PieceSteps::KNIGHT_MOVES[ix] & pd.targetSquares;
+    }
+
+    template<State state>
+    BB bishops(const Board& board, const PinData& pd) {
+        return board.bishops<state.whiteToMove>() & ~pd.pinsStr;
+    }
+
+    inline BB bishop(const Board& board, const PinData& pd, int ix) {
+        BB targets = PieceSteps::slideMask<true>(board.occ(), ix) & pd.targetSquares;
+        if(hasBitAt(pd.pinsDiag, ix)) targets &= pd.pinsDiag;
+        return targets;
+    }
+
+    template<State state>
+    BB rooks(const Board& board, const PinData& pd) {
+        return board.rooks<state.whiteToMove>() & ~pd.pinsDiag;
+    }
+
+    inline BB rook(const Board& board, const PinData& pd, int ix) {
+        BB targets = PieceSteps::slideMask<false>(board.occ(), ix) & pd.targetSquares;
+        if(hasBitAt(pd.pinsStr, ix)) targets &= pd.pinsStr;
+        return targets;
+    }
+
+    // a queen can only be pinned along one line, so it moves either straight or diagonally then
+    inline BB queen(const Board& board, const PinData& pd, int ix) {
+        if(hasBitAt(pd.pinsStr, ix)) return PieceSteps::slideMask<false>(board.occ(), ix) & pd.targetSquares & pd.pinsStr;
+        if(hasBitAt(pd.pinsDiag, ix)) return PieceSteps::slideMask<true>(board.occ(), ix) & pd.targetSquares & pd.pinsDiag;
+        return (PieceSteps::slideMask<false>(board.occ(), ix) | PieceSteps::slideMask<true>(board.occ(), ix)) & pd.targetSquares;
+    }
+
+    template<State state>
+    BB king(const Board& board, const PinData& pd) {
+        BB king = board.king<state.whiteToMove>();
+        return PieceSteps::KING_MOVES[singleBitOf(king)] & ~pd.attacked & board.enemyOrEmpty<state.whiteToMove>();
+    }
+
+    template<State state>
+    bool castleShort(const Board& board, const PinData& pd) {
+        constexpr bool white = state.whiteToMove;
+        constexpr BB startKing = white ? STARTBOARD.wKing : STARTBOARD.bKing;
+        constexpr BB csMask = castleShortMask<white>();
+        BB kingBB = board.king<white>();
+        return canCastleShort<state>()
+               && kingBB == startKing
+               && board.rooks<white>() & startingKingsideRook<white>()
+               && (csMask & pd.attacked) == 0
+               && (csMask & board.occ()) == kingBB;
+    }
+
+    template<State state>
+    bool castleLong(const Board& board, const PinData& pd) {
+        constexpr bool white = state.whiteToMove;
+        constexpr BB startKing = white ? STARTBOARD.wKing : STARTBOARD.bKing;
+        constexpr BB clMask = castleLongMask<white>();
+        BB kingBB = board.king<white>();
+        return canCastleLong<state>()
+               && kingBB == startKing
+               && board.rooks<white>() & startingQueensideRook<white>()
+               && (clMask & pd.attacked) == 0
+               && (clMask & board.occ()) == kingBB
+               && board.free() & (startingQueensideRook<white>() << 1);
+    }
+}
+
+/**
+ * Generates the legal moves of a position and hands them to MoveCollector.
+ * A collector that declares 'static constexpr bool capturesOnly = true;' only receives captures (en passant included)
+ * and promotions, e.g. for a quiescence search. Castling and quiet moves are then never generated.
+ */
+template<typename MoveCollector, typename = MovePolicy::CopyMake>
 class MoveGenerator {
+    static constexpr bool profiled = Profiling::enabled<MoveCollector>;
+    static constexpr bool capturesOnly = requires { requires MoveCollector::capturesOnly; };
+    using Scope = Profiling::Scope<profiled>;
+
 public:
     template<State, int>
     static void generate(Board& board);
@@ -30,59 +187,89 @@ private:
     template<State, int>
     static void pawnMoves(Board& board, PinData& pd);
 
+    // the optional 'candidates' restrict the pieces that are considered, see evasions
     template<State, int>
-    static void knightMoves(Board& board, PinData& pd);
+    static void knightMoves(Board& board, PinData& pd, BB candidates = FULL_BB);
 
     template<State, int>
-    static void bishopMoves(Board& board, PinData& pd);
+    static void bishopMoves(Board& board, PinData& pd, BB candidates = FULL_BB);
 
     template<State, int>
-    static void rookMoves(Board& board, PinData& pd);
+    static void rookMoves(Board& board, PinData& pd, BB candidates = FULL_BB);
 
     template<State, int>
-    static void queenMoves(Board& board, PinData& pd);
+    static void queenMoves(Board& board, PinData& pd, BB candidates = FULL_BB);
 
     template<State, int>
     static void kingMoves(Board& board, PinData& pd);
 
     template<State, int>
     static void castles(Board& board, PinData& pd);
+
+    template<State, int>
+    static void evasions(Board& board, PinData& pd);
 };
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::generate(Board& board) {
-    PinData pd = CheckLogicHandler::reload<state>(board);
-
-    if(!pd.isDoubleCheck) {
+void MoveGenerator<MoveCollector, Policy>::generate(Board& board) {
+    PinData pd = [&board] {
+        [[maybe_unused]] Scope scope{Profiling::Reload, depth};
+        return CheckLogicHandler::reload<state>(board);
+    }();
+    if constexpr (capturesOnly) pd.targetSquares &= board.enemyPieces<state.whiteToMove>();
+
+    if(pd.checkMask != FULL_BB) {
+        if(!pd.isDoubleCheck) evasions<state, depth>(board, pd);
+    } else {
         pawnMoves<state, depth>(board, pd);
         knightMoves<state, depth>(board, pd);
         bishopMoves<state, depth>(board, pd);
         rookMoves<state, depth>(board, pd);
         queenMoves<state, depth>(board, pd);
 
-        if constexpr(canCastle<state>())
+        if constexpr(canCastle<state>() && !capturesOnly)
             castles<state, depth>(board, pd);
     }
 
     kingMoves<state, depth>(board, pd);
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth, Piece_t piece, Flag_t flags>
-void MoveGenerator<MoveCollector>::generateSuccessorBoard(Board& board, BB from, BB to) {
+void MoveGenerator<MoveCollector, Policy>::generateSuccessorBoard(Board& board, BB from, BB to) {
     constexpr State nextState = getNextState<state, flags>();
-    Board nextBoard = board.getNextBoard<state, piece, flags>(from, to);
+    {
+        [[maybe_unused]] Scope scope{Profiling::Collector, depth};
+        MoveCollector::template registerMove<state, depth, piece, flags>(board, from, to);
+    }
 
-    MoveCollector::template registerMove<state, depth, piece, flags>(board, from, to);
-    MoveCollector::template next<nextState, depth>(nextBoard);
+    if constexpr (std::is_same_v<Policy, MovePolicy::MakeUnmake>) {
+        UndoInfo undo = [&] {
+            [[maybe_unused]] Scope scope{Profiling::NextBoard, depth};
+            return board.makeMove<state, piece, flags>(from, to);
+        }();
+        {
+            [[maybe_unused]] Scope scope{Profiling::Collector, depth};
+            MoveCollector::template next<nextState, depth>(board);
+        }
+        [[maybe_unused]] Scope scope{Profiling::NextBoard, depth};
+        board.unmakeMove<state, piece, flags>(from, to, undo);
+    } else {
+        Board nextBoard = [&] {
+            [[maybe_unused]] Scope scope{Profiling::NextBoard, depth};
+            return board.getNextBoard<state, piece, flags>(from, to);
+        }();
+        [[maybe_unused]] Scope scope{Profiling::Collector, depth};
+        MoveCollector::template next<nextState, depth>(nextBoard);
+    }
 }
 
 // - - - - - - Helper Functions - - - - - -
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth, Piece_t piece, Flag_t flags>
-void MoveGenerator<MoveCollector>::addToList(Board& board, int fromIndex, BB targets) {
+void MoveGenerator<MoveCollector, Policy>::addToList(Board& board, int fromIndex, BB targets) {
     BB fromBB = newMask(fromIndex);
     Bitloop(targets) {
         BB toBB = isolateLowestBit(targets);
@@ -90,9 +277,9 @@ void MoveGenerator<MoveCollector>::addToList(Board& board, int fromIndex, BB tar
     }
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::handlePromotions(Board& board, BB from, BB to) {
+void MoveGenerator<MoveCollector, Policy>::handlePromotions(Board& board, BB from, BB to) {
     generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::PromoteQueen>(board, from, to);
     generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::PromoteRook>(board, from, to);
     generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::PromoteBishop>(board, from, to);
@@ -101,136 +288,94 @@ void MoveGenerator<MoveCollector>::handlePromotions(Board& board, BB from, BB to
 
 // - - - - - - Individual Piece Moves - - - - - -
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::pawnMoves(Board& board, PinData& pd) {
+void MoveGenerator<MoveCollector, Policy>::pawnMoves(Board& board, PinData& pd) {
+    [[maybe_unused]] Scope scope{Profiling::Pawns, depth};
     constexpr bool white = state.whiteToMove;
-    BB free = board.free();
-    BB enemy = board.enemyPieces<white>();
-    BB pawnsFwd = board.pawns<white>() & ~pd.pinsDiag;
-    BB pawnCapt = board.pawns<white>() & ~pd.pinsStr;
-
-    // pawns that can move 1 or 2 squares
-    BB pwnMov = pawnsFwd & backward<white>(free);
-    BB pwnMov2 = pwnMov & backward2<white>(free & pd.checkMask) & firstRank<white>();
-    pwnMov &= backward<white>(pd.checkMask);
-
-    // pawns that can capture Left or Right
-    BB pawnCapL = pawnCapt & pawnInvAtkLeft<white>(enemy & pd.checkMask) & pawnCanGoLeft<white>();
-    BB pawnCapR = pawnCapt & pawnInvAtkRight<white>(enemy & pd.checkMask) & pawnCanGoRight<white>();
-
-    // remove pinned pawns
-    pwnMov      &= backward<white> (pd.pinsStr) | ~pd.pinsStr;
-    pwnMov2     &= backward2<white>(pd.pinsStr) | ~pd.pinsStr;
-    pawnCapL    &= pawnInvAtkLeft<white> (pd.pinsDiag & pawnCanGoRight<white>()) | ~pd.pinsDiag;
-    pawnCapR    &= pawnInvAtkRight<white>(pd.pinsDiag & pawnCanGoLeft <white>()) | ~pd.pinsDiag;
-
-    // handle en passant pawns
-    BB epPawnL{0}, epPawnR{0};
-    BB enPassant = board.enPassantField;
-    if(enPassant != 0 && !pd.blockEP) {
-        // left capture is ep square and is on checkmask
-        epPawnL = pawnCapt & pawnCanGoLeft<white>() & pawnInvAtkLeft<white>(enPassant & forward<white>(pd.checkMask));
-        // remove pinned ep pawns
-        epPawnL &= pawnInvAtkLeft<white>(pd.pinsDiag & pawnCanGoLeft<white>()) | ~pd.pinsDiag;
-
-        // right capture is ep square and is on checkmask
-        epPawnR = pawnCapt & pawnCanGoRight<white>() & pawnInvAtkRight<white>(enPassant & forward<white>(pd.checkMask));
-        // remove pinned ep pawns
-        epPawnR &= pawnInvAtkRight<white>(pd.pinsDiag & pawnCanGoRight<white>()) | ~pd.pinsDiag;
-    }
-
-    // collect all promoting pawns in separate variables
-    BB lastRowMask      = pawnOnLastRow<white>();
-    BB pwnPromoteFwd    = pwnMov   & lastRowMask;
-    BB pwnPromoteL      = pawnCapL & lastRowMask;
-    BB pwnPromoteR      = pawnCapR & lastRowMask;
-
-    // remove all promoting pawns from these collections
-    pwnMov &= ~lastRowMask;
-    pawnCapL &= ~lastRowMask;
-    pawnCapR &= ~lastRowMask;
+    MoveTargets::Pawns p = MoveTargets::pawns<state>(board, pd);
 
     BB from;
     // non-promoting pawn moves
-    Bitloop(pwnMov) {   // straight push, 1 square
-        from = isolateLowestBit(pwnMov);
-        generateSuccessorBoard<state, depth, Piece::Pawn>(board, from, forward<white>(from));
+    if constexpr (!capturesOnly) {
+        Bitloop(p.push) {   // straight push, 1 square
+            from = isolateLowestBit(p.push);
+            generateSuccessorBoard<state, depth, Piece::Pawn>(board, from, forward<white>(from));
+        }
     }
-    Bitloop(pawnCapL) { // capture towards left
-        from = isolateLowestBit(pawnCapL);
+    Bitloop(p.captureLeft) { // capture towards left
+        from = isolateLowestBit(p.captureLeft);
         generateSuccessorBoard<state, depth, Piece::Pawn>(board, from, pawnAtkLeft<white>(from));
     }
-    Bitloop(pawnCapR) { // capture towards right
-        from = isolateLowestBit(pawnCapR);
+    Bitloop(p.captureRight) { // capture towards right
+        from = isolateLowestBit(p.captureRight);
         generateSuccessorBoard<state, depth, Piece::Pawn>(board, from, pawnAtkRight<white>(from));
     }
 
     // promoting pawn moves
-    Bitloop(pwnPromoteFwd) {    // single push + promotion
-        from = isolateLowestBit(pwnPromoteFwd);
+    Bitloop(p.promotePush) {    // single push + promotion
+        from = isolateLowestBit(p.promotePush);
         handlePromotions<state, depth>(board, from, forward<white>(from));
     }
-    Bitloop(pwnPromoteL) {    // capture left + promotion
-        from = isolateLowestBit(pwnPromoteL);
+    Bitloop(p.promoteLeft) {    // capture left + promotion
+        from = isolateLowestBit(p.promoteLeft);
         handlePromotions<state, depth>(board, from, pawnAtkLeft<white>(from));
     }
-    Bitloop(pwnPromoteR) {    // capture right + promotion
-        from = isolateLowestBit(pwnPromoteR);
+    Bitloop(p.promoteRight) {    // capture right + promotion
+        from = isolateLowestBit(p.promoteRight);
         handlePromotions<state, depth>(board, from, pawnAtkRight<white>(from));
     }
 
     // pawn moves that cannot be promotions
-    Bitloop(pwnMov2) {    // pawn double push
-        from = isolateLowestBit(pwnMov2);
-        generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::PawnDoublePush>(board, from, forward2<white>(from));
+    if constexpr (!capturesOnly) {
+        Bitloop(p.doublePush) {    // pawn double push
+            from = isolateLowestBit(p.doublePush);
+            generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::PawnDoublePush>(board, from, forward2<white>(from));
+        }
     }
-    Bitloop(epPawnL) {    // pawn double push
-        from = isolateLowestBit(epPawnL);
+    Bitloop(p.epLeft) {    // en passant left
+        from = isolateLowestBit(p.epLeft);
         generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::EnPassantCapture>(board, from, pawnAtkLeft<white>(from));
     }
-    Bitloop(epPawnR) {    // pawn double push
-        from = isolateLowestBit(epPawnR);
+    Bitloop(p.epRight) {    // en passant right
+        from = isolateLowestBit(p.epRight);
         generateSuccessorBoard<state, depth, Piece::Pawn, MoveFlag::EnPassantCapture>(board, from, pawnAtkRight<white>(from));
     }
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::knightMoves(Board& board, PinData& pd) {
-    BB allPins = pd.pinsStr | pd.pinsDiag;
-    BB movKnights = board.knights<state.whiteToMove>() & ~allPins;
+void MoveGenerator<MoveCollector, Policy>::knightMoves(Board& board, PinData& pd, BB candidates) {
+    [[maybe_unused]] Scope scope{Profiling::Knights, depth};
+    BB movKnights = MoveTargets::knights<state>(board, pd) & candidates;
 
     Bitloop(movKnights) {
         int ix = firstBitOf(movKnights);
-        BB targets = PieceSteps::KNIGHT_MOVES[ix] & pd.targetSquares;
-        addToList<state, depth, Piece::Knight>(board, ix, targets);
+        addToList<state, depth, Piece::Knight>(board, ix, MoveTargets::knight(pd, ix));
     }
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::bishopMoves(Board& board, PinData& pd) {
-    BB bishops = board.bishops<state.whiteToMove>() & ~pd.pinsStr;
+void MoveGenerator<MoveCollector, Policy>::bishopMoves(Board& board, PinData& pd, BB candidates) {
+    [[maybe_unused]] Scope scope{Profiling::Bishops, depth};
+    BB bishops = MoveTargets::bishops<state>(board, pd) & candidates;
 
     Bitloop(bishops) {
         int ix = firstBitOf(bishops);
-        BB targets = PieceSteps::slideMask<true>(board.occ(), ix) & pd.targetSquares;
-        if(hasBitAt(pd.pinsDiag, ix)) targets &= pd.pinsDiag;
-        addToList<state, depth, Piece::Bishop>(board, ix, targets);
+        addToList<state, depth, Piece::Bishop>(board, ix, MoveTargets::bishop(board, pd, ix));
     }
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::rookMoves(Board& board, PinData& pd) {
-    BB rooks = board.rooks<state.whiteToMove>() & ~pd.pinsDiag;
+void MoveGenerator<MoveCollector, Policy>::rookMoves(Board& board, PinData& pd, BB candidates) {
+    [[maybe_unused]] Scope scope{Profiling::Rooks, depth};
+    BB rooks = MoveTargets::rooks<state>(board, pd) & candidates;
 
     Bitloop(rooks) {
         int ix = firstBitOf(rooks);
-
-        BB targets = PieceSteps::slideMask<false>(board.occ(), ix) & pd.targetSquares;
-        if(hasBitAt(pd.pinsStr, ix)) targets &= pd.pinsStr;
+        BB targets = MoveTargets::rook(board, pd, ix);
 
         if constexpr(canCastleShort<state>()) {
             if (hasBitAt(startingKingsideRook<state.whiteToMove>(), ix)) {
@@ -249,66 +394,76 @@ void MoveGenerator<MoveCollector>::rookMoves(Board& board, PinData& pd) {
     }
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::queenMoves(Board& board, PinData& pd) {
-    BB queens = board.queens<state.whiteToMove>();
-    BB queensPinStr = queens & pd.pinsStr & ~pd.pinsDiag;
-    BB queensPinDiag = queens & pd.pinsDiag & ~pd.pinsStr;
-    BB queensNoPin = queens & ~(pd.pinsDiag | pd.pinsStr);
-
-    Bitloop(queensPinStr) {
-        int ix = firstBitOf(queensPinStr);
-        BB targets = PieceSteps::slideMask<false>(board.occ(), ix) & pd.targetSquares & pd.pinsStr;
-        addToList<state, depth, Piece::Queen>(board, ix, targets);
-    }
-
-    Bitloop(queensPinDiag) {
-        int ix = firstBitOf(queensPinDiag);
-        BB targets = PieceSteps::slideMask<true>(board.occ(), ix) & pd.targetSquares & pd.pinsDiag;
-        addToList<state, depth, Piece::Queen>(board, ix, targets);
-    }
+void MoveGenerator<MoveCollector, Policy>::queenMoves(Board& board, PinData& pd, BB candidates) {
+    [[maybe_unused]] Scope scope{Profiling::Queens, depth};
+    BB queens = board.queens<state.whiteToMove>() & candidates;
 
-    Bitloop(queensNoPin) {
-        int ix = firstBitOf(queensNoPin);
-        BB targets = PieceSteps::slideMask<false>(board.occ(), ix) & pd.targetSquares;
-        targets |= PieceSteps::slideMask<true>(board.occ(), ix) & pd.targetSquares;
-        addToList<state, depth, Piece::Queen>(board, ix, targets);
+    Bitloop(queens) {
+        int ix = firstBitOf(queens);
+        addToList<state, depth, Piece::Queen>(board, ix, MoveTargets::queen(board, pd, ix));
     }
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::kingMoves(Board& board, PinData& pd) {
-    BB king = board.king<state.whiteToMove>();
-    int ix = singleBitOf(king);
-    BB targets = PieceSteps::KING_MOVES[ix] & ~pd.attacked & board.enemyOrEmpty<state.whiteToMove>();
+void MoveGenerator<MoveCollector, Policy>::kingMoves(Board& board, PinData& pd) {
+    [[maybe_unused]] Scope scope{Profiling::King, depth};
+    int ix = singleBitOf(board.king<state.whiteToMove>());
+    BB targets = MoveTargets::king<state>(board, pd);
+    if constexpr (capturesOnly) targets &= board.enemyPieces<state.whiteToMove>();
     addToList<state, depth, Piece::King, MoveFlag::RemoveAllCastling>(board, ix, targets);
 }
 
-template<typename MoveCollector>
+template<typename MoveCollector, typename Policy>
 template<State state, int depth>
-void MoveGenerator<MoveCollector>::castles(Board& board, PinData& pd) {
-    constexpr bool white = state.whiteToMove;
-    constexpr BB startKing = white ? STARTBOARD.wKing : STARTBOARD.bKing;
-    constexpr BB csMask = castleShortMask<white>();
-    constexpr BB clMask = castleLongMask<white>();
-    BB kingBB = board.king<white>();
+void MoveGenerator<MoveCollector, Policy>::castles(Board& board, PinData& pd) {
+    [[maybe_unused]] Scope scope{Profiling::Castles, depth};
+    BB kingBB = board.king<state.whiteToMove>();
 
     if constexpr (canCastleShort<state>())
-        if(kingBB == startKing
-               && board.rooks<white>() & startingKingsideRook<white>()
-               && (csMask & pd.attacked) == 0
-               && (csMask & board.occ()) == kingBB
-        ) generateSuccessorBoard<state, depth, Piece::King, MoveFlag::ShortCastling>(board, kingBB, kingBB << 2);
+        if(MoveTargets::castleShort<state>(board, pd))
+            generateSuccessorBoard<state, depth, Piece::King, MoveFlag::ShortCastling>(board, kingBB, kingBB << 2);
 
     if constexpr (canCastleLong<state>())
-        if(kingBB == startKing
-           && board.rooks<white>() & startingQueensideRook<white>()
-           && (clMask & pd.attacked) == 0
-           && (clMask & board.occ()) == kingBB
-           && board.free() & (startingQueensideRook<white>() << 1)
-        ) generateSuccessorBoard<state, depth, Piece::King, MoveFlag::LongCastling>(board, kingBB, kingBB >> 2);
+        if(MoveTargets::castleLong<state>(board, pd))
+            generateSuccessorBoard<state, depth, Piece::King, MoveFlag::LongCastling>(board, kingBB, kingBB >> 2);
+}
+
+/**
+ * Moves out of a single check, except for the king moves. Only pieces that reach a square of the checkMask (the checker
+ * or a square between it and the king) can help, so these are looked up from the checkMask squares instead of
+ * expanding every piece. Pinned pieces never resolve a check, castling is illegal.
+ * The moves come in the same order as from the regular path.
+ */
+template<typename MoveCollector, typename Policy>
+template<State state, int depth>
+void MoveGenerator<MoveCollector, Policy>::evasions(Board& board, PinData& pd) {
+    constexpr bool white = state.whiteToMove;
+    pawnMoves<state, depth>(board, pd);
+
+    BB occ = board.occ();
+    BB knights = board.knights<white>();
+    BB diagonal = board.bishops<white>() | board.queens<white>();
+    BB straight = board.rooks<white>() | board.queens<white>();
+    BB candidates = 0;
+    BB squares = pd.checkMask;
+    Bitloop(squares) {
+        int ix = firstBitOf(squares);
+        candidates |= (PieceSteps::KNIGHT_MOVES[ix] & knights)
+                    | (PieceSteps::slideMask<true>(occ, ix) & diagonal)
+                    | (PieceSteps::slideMask<false>(occ, ix) & straight);
+    }
+    candidates &= ~(pd.pinsStr | pd.pinsDiag);
+    if(!candidates) return;
+
+    knightMoves<state, depth>(board, pd, candidates);
+    bishopMoves<state, depth>(board, pd, candidates);
+    rookMoves<state, depth>(board, pd, candidates);
+    queenMoves<state, depth>(board, pd, candidates);
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_MOVEGEN_H
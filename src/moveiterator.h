@@ -0,0 +1,139 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include "movegen.h"
+
+#ifndef DORY_MOVEITERATOR_H
+#define DORY_MOVEITERATOR_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Lazy alternative to MoveGenerator: yields the legal moves of a position one at a time, so callers that only need
+ * some of them (any legal move, a specific move, the first capture) can stop early.
+ * The moves come in the same order as from MoveGenerator and are computed by the same MoveTargets functions.
+ *
+ *      MoveIterator<state> it{board};
+ *      Move move;
+ *      while(it.next(move)) { ... }
+ *
+ * The board must not change while the iterator is in use.
+ */
+template<State state>
+class MoveIterator {
+    static constexpr bool white = state.whiteToMove;
+
+    enum Stage : uint8_t {
+        PawnPush, PawnCaptureLeft, PawnCaptureRight, PromotePush, PromoteLeft, PromoteRight,
+        DoublePush, EnPassantLeft, EnPassantRight, Knights, Bishops, Rooks, Queens, CastleShort, CastleLong, King, Done
+    };
+
+    static constexpr Piece_t PIECES[Done] = {
+        Piece::Pawn, Piece::Pawn, Piece::Pawn, Piece::Pawn, Piece::Pawn, Piece::Pawn, Piece::Pawn, Piece::Pawn, Piece::Pawn,
+        Piece::Knight, Piece::Bishop, Piece::Rook, Piece::Queen, Piece::King, Piece::King, Piece::King
+    };
+
+    static constexpr Flag_t FLAGS[Done] = {
+        MoveFlag::Silent, MoveFlag::Silent, MoveFlag::Silent, MoveFlag::PromoteQueen, MoveFlag::PromoteQueen, MoveFlag::PromoteQueen,
+        MoveFlag::PawnDoublePush, MoveFlag::EnPassantCapture, MoveFlag::EnPassantCapture, MoveFlag::Silent, MoveFlag::Silent,
+        MoveFlag::Silent, MoveFlag::Silent, MoveFlag::ShortCastling, MoveFlag::LongCastling, MoveFlag::RemoveAllCastling
+    };
+
+    const Board& board;
+    PinData pd;
+    std::array<BB, Done> sources{};     // pieces that still have to be expanded, per stage
+    BB targets{0};                      // remaining targets of the current piece
+    int stage{PawnPush}, from{0};
+    Flag_t flags{MoveFlag::Silent};
+
+    static constexpr bool promotes(int stage) {
+        return stage >= PromotePush && stage <= PromoteRight;
+    }
+
+    static constexpr Flag_t rookFlags(int ix) {
+        if(canCastleShort<state>() && hasBitAt(startingKingsideRook<white>(), ix)) return MoveFlag::RemoveShortCastling;
+        if(canCastleLong<state>() && hasBitAt(startingQueensideRook<white>(), ix)) return MoveFlag::RemoveLongCastling;
+        return MoveFlag::Silent;
+    }
+
+    BB targetsOf(int ix) {
+        BB fromBB = newMask(ix);
+        switch(stage) {
+            case PawnPush: case PromotePush: return forward<white>(fromBB);
+            case DoublePush: return forward2<white>(fromBB);
+            case PawnCaptureLeft: case PromoteLeft: case EnPassantLeft: return pawnAtkLeft<white>(fromBB);
+            case PawnCaptureRight: case PromoteRight: case EnPassantRight: return pawnAtkRight<white>(fromBB);
+            case Knights: return MoveTargets::knight(pd, ix);
+            case Bishops: return MoveTargets::bishop(board, pd, ix);
+            case Rooks:
+                flags = rookFlags(ix);
+                return MoveTargets::rook(board, pd, ix);
+            case Queens: return MoveTargets::queen(board, pd, ix);
+            case CastleShort: return fromBB << 2;
+            case CastleLong: return fromBB >> 2;
+            default: return MoveTargets::king<state>(board, pd);
+        }
+    }
+
+    // moves on to the next piece that has targets, kept out of line so that next() stays small
+    [[gnu::noinline]] bool nextPiece() {
+        while(!targets) {
+            while(stage != Done && !sources[stage])
+                if(++stage != Done) flags = FLAGS[stage];
+            if(stage == Done) return false;
+
+            from = firstBitOf(sources[stage]);
+            sources[stage] &= sources[stage] - 1;
+            targets = targetsOf(from);
+        }
+        return true;
+    }
+
+public:
+    explicit MoveIterator(Board& board) : board{board}, pd{CheckLogicHandler::reload<state>(board)} {
+        sources[King] = board.king<white>();
+        if(pd.isDoubleCheck) return;
+
+        MoveTargets::Pawns p = MoveTargets::pawns<state>(board, pd);
+        sources[PawnPush] = p.push;
+        sources[PawnCaptureLeft] = p.captureLeft;
+        sources[PawnCaptureRight] = p.captureRight;
+        sources[PromotePush] = p.promotePush;
+        sources[PromoteLeft] = p.promoteLeft;
+        sources[PromoteRight] = p.promoteRight;
+        sources[DoublePush] = p.doublePush;
+        sources[EnPassantLeft] = p.epLeft;
+        sources[EnPassantRight] = p.epRight;
+        sources[Knights] = MoveTargets::knights<state>(board, pd);
+        sources[Bishops] = MoveTargets::bishops<state>(board, pd);
+        sources[Rooks] = MoveTargets::rooks<state>(board, pd);
+        sources[Queens] = board.queens<white>();
+        if constexpr (canCastleShort<state>())
+            if(MoveTargets::castleShort<state>(board, pd)) sources[CastleShort] = board.king<white>();
+        if constexpr (canCastleLong<state>())
+            if(MoveTargets::castleLong<state>(board, pd)) sources[CastleLong] = board.king<white>();
+    }
+
+    [[nodiscard]] const PinData& pinData() const {
+        return pd;
+    }
+
+    // writes the next legal move into 'move', returns false once all moves have been produced
+    bool next(Move& move) {
+        if(!targets && !nextPiece()) return false;
+
+        move = { newMask(from), isolateLowestBit(targets), PIECES[stage], flags };
+        // promotions yield the same target once per piece type
+        if(promotes(stage) && flags != MoveFlag::PromoteKnight) flags++;
+        else {
+            targets &= targets - 1;
+            if(promotes(stage)) flags = MoveFlag::PromoteQueen;
+        }
+        return true;
+    }
+};
+
+DORY_NAMESPACE_END
+
+#endif //DORY_MOVEITERATOR_H
@@ -0,0 +1,166 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <array>
+#include <new>
+#include <utility>
+#include "board.h"
+
+#ifndef DORY_MOVEORDERING_H
+#define DORY_MOVEORDERING_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Building blocks for ordering moves in a search: the captured piece of a move, MVV-LVA scores,
+ * killer moves per ply and a history table indexed by from and to square.
+ */
+namespace MoveOrdering {
+
+    // indexed by Piece_t, i.e. none, king, queen, rook, bishop, knight, pawn
+    constexpr std::array<int, 7> PIECE_VALUES{0, 20000, 900, 500, 330, 320, 100};
+
+    // the piece captured by a move of the side to move, 0 for quiet moves
+    template<State state, Flag_t flags>
+    constexpr Piece_t victim(const Board& board, BB to) {
+        if constexpr (flags == MoveFlag::EnPassantCapture) return Piece::Pawn;
+        else return board.pieceAt<!state.whiteToMove>(to);
+    }
+
+    // most valuable victim first, the least valuable attacker breaks ties
+    constexpr int mvvLva(Piece_t victim, Piece_t attacker) {
+        return 16 * PIECE_VALUES[victim] - PIECE_VALUES[attacker] / 16;
+    }
+
+    // score bands, so that captures and promotions come first, then the killers, then the quiet moves by history
+    constexpr int CAPTURE_SCORE = 1 << 28;
+    constexpr int KILLER_SCORE = 1 << 27;
+
+    constexpr int MAX_PLY = 64;
+
+    // quiet moves that caused a beta cutoff, two per ply
+    class Killers {
+        std::array<std::array<PackedMove, 2>, MAX_PLY> slots{};
+
+    public:
+        void store(int ply, PackedMove move) {
+            if(slots[ply][0] != move) {
+                slots[ply][1] = slots[ply][0];
+                slots[ply][0] = move;
+            }
+        }
+
+        // 2 for the newest killer, 1 for the older one and 0 otherwise
+        [[nodiscard]] int rank(int ply, PackedMove move) const {
+            if(slots[ply][0] == move) return 2;
+            if(slots[ply][1] == move) return 1;
+            return 0;
+        }
+
+        void clear() {
+            slots = {};
+        }
+    };
+
+    // butterfly table: how often a quiet move from - to caused a cutoff, weighted by the remaining depth
+    class History {
+        std::array<std::array<std::array<int, 64>, 64>, 2> table{};
+
+    public:
+        void update(bool white, PackedMove move, int depth) {
+            int& entry = table[white][packedFrom(move)][packedTo(move)];
+            entry += depth * depth;
+            // keep all scores below the killer band
+            if(entry >= KILLER_SCORE) age();
+        }
+
+        [[nodiscard]] int score(bool white, PackedMove move) const {
+            return table[white][packedFrom(move)][packedTo(move)];
+        }
+
+        void age() {
+            for(auto& from: table)
+                for(auto& to: from)
+                    for(int& entry: to) entry /= 2;
+        }
+
+        void clear() {
+            table = {};
+        }
+    };
+
+    // the fields the ordering needs, search collectors derive their list entries from it
+    struct ScoredMove {
+        PackedMove move{0};
+        Piece_t piece{0}, captured{0};
+        int score{0};
+    };
+
+    /**
+     * Fixed capacity move buffer meant to live on the stack of a search node.
+     * pick(i) moves the best remaining move to position i (selection sort), which is cheaper than sorting the
+     * whole list when a cutoff happens after the first few moves.
+     *
+     * @tparam Entry - ScoredMove or a type derived from it, e.g. carrying the successor board
+     */
+    template<typename Entry = ScoredMove>
+    class MoveList {
+        // the entries are only constructed when added, so that a new list does not clear MAX_MOVES entries
+        union Slot {
+            Entry entry;
+            Slot() {}
+        };
+
+        std::array<Slot, MAX_MOVES> moves;
+        int count{0};
+
+    public:
+        Entry& add() {
+            return *new (&moves[count++].entry) Entry{};
+        }
+
+        Entry& back() {
+            return moves[count - 1].entry;
+        }
+
+        Entry& operator[](int i) {
+            return moves[i].entry;
+        }
+
+        [[nodiscard]] int size() const {
+            return count;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return count == 0;
+        }
+
+        void score(bool white, int ply, const Killers& killers, const History& history) {
+            for(int i = 0; i < count; i++) {
+                ScoredMove& m = moves[i].entry;
+                Flag_t flags = packedFlags(m.move);
+                if(m.captured || isPromotion(flags)) {
+                    m.score = CAPTURE_SCORE + mvvLva(m.captured, m.piece);
+                    if(flags == MoveFlag::PromoteQueen) m.score += PIECE_VALUES[Piece::Queen];
+                } else if(int rank = killers.rank(ply, m.move)) {
+                    m.score = KILLER_SCORE + rank;
+                } else {
+                    m.score = history.score(white, m.move);
+                }
+            }
+        }
+
+        Entry& pick(int i) {
+            int best = i;
+            for(int j = i + 1; j < count; j++)
+                if(moves[j].entry.score > moves[best].entry.score) best = j;
+            if(best != i) std::swap(moves[i].entry, moves[best].entry);
+            return moves[i].entry;
+        }
+    };
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_MOVEORDERING_H
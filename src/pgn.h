@@ -0,0 +1,437 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "mappedfile.h"
+#include "movegen.h"
+#include "utils.h"
+#include "fenreader.h"
+#include "gamestate.h"
+#include "see.h"
+
+#ifndef DORY_PGN_H
+#define DORY_PGN_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Reading games in Portable Game Notation. Moves in standard algebraic notation (SAN) are decoded by matching them
+ * against the legal moves of the position, so every game is replayed by the move generator itself and a move that
+ * is not legal is reported instead of corrupting the position.
+ *
+ * replay() calls a visitor for every position of a game. replayAll() splits a whole file (usually a Reader, which
+ * maps it into memory) into blocks of about a megabyte that the threads take one after another, each thread
+ * replaying the games that start in its block.
+ */
+namespace PGN {
+
+    // a move in standard algebraic notation, as far as it is spelled out
+    struct SAN {
+        Piece_t piece{Piece::Pawn};
+        int to{-1};
+        int fromFile{-1}, fromRank{-1};     // disambiguation, -1 if not given
+        Flag_t special{MoveFlag::Silent};   // castling or the promotion, Silent otherwise
+    };
+
+    constexpr std::string_view PIECE_LETTERS{"?KQRBNP"};
+
+    constexpr Flag_t promotionFlag(char letter) {
+        switch(letter) {
+            case 'Q': return MoveFlag::PromoteQueen;
+            case 'R': return MoveFlag::PromoteRook;
+            case 'B': return MoveFlag::PromoteBishop;
+            case 'N': return MoveFlag::PromoteKnight;
+            default: return MoveFlag::Silent;
+        }
+    }
+
+    /**
+     * Parses tokens like "Nbxd7+", "exd8=Q#", "e8Q", "O-O-O" or "0-0". Check marks, annotations ("!?") and "e.p."
+     * are ignored. Returns false for anything else.
+     */
+    constexpr bool parseSAN(std::string_view token, SAN& san) {
+        san = {};
+        if(token.ends_with("e.p.")) token.remove_suffix(4);
+        while(!token.empty() && (token.back() == '+' || token.back() == '#' || token.back() == '!' || token.back() == '?'))
+            token.remove_suffix(1);
+
+        if(token == "O-O" || token == "0-0") {
+            san.piece = Piece::King;
+            san.special = MoveFlag::ShortCastling;
+            return true;
+        }
+        if(token == "O-O-O" || token == "0-0-0") {
+            san.piece = Piece::King;
+            san.special = MoveFlag::LongCastling;
+            return true;
+        }
+
+        if(!token.empty() && promotionFlag(token.back()) != MoveFlag::Silent) {
+            san.special = promotionFlag(token.back());
+            token.remove_suffix(1);
+            if(!token.empty() && token.back() == '=') token.remove_suffix(1);
+        }
+        if(token.size() < 2) return false;
+        char file = token[token.size() - 2], rank = token.back();
+        if(file < 'a' || file > 'h' || rank < '1' || rank > '8') return false;
+        san.to = (rank - '1') * 8 + (file - 'a');
+        token.remove_suffix(2);
+
+        if(!token.empty() && token[0] >= 'B' && token[0] <= 'R') {
+            size_t piece = PIECE_LETTERS.find(token[0]);
+            if(piece == std::string_view::npos || piece == Piece::Pawn) return false;
+            san.piece = static_cast<Piece_t>(piece);
+            token.remove_prefix(1);
+        }
+        if(!token.empty() && (token.back() == 'x' || token.back() == ':')) token.remove_suffix(1);
+        for(char c: token) {
+            if(c >= 'a' && c <= 'h') san.fromFile = c - 'a';
+            else if(c >= '1' && c <= '8') san.fromRank = c - '1';
+            else return false;
+        }
+        // only pawns promote
+        return san.special == MoveFlag::Silent || san.piece == Piece::Pawn;
+    }
+
+    // finds the legal moves of a position that fit a SAN move
+    struct Decoder {
+        static thread_local SAN san;
+        static thread_local BB target;      // the to square of san
+        static thread_local int matches;
+        static thread_local BB sources;     // the from squares of the matches
+        static thread_local PackedMove result;
+        static thread_local ExtendedBoard successor;
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            MoveGenerator<Decoder>::template generate<state, 1>(board);
+        }
+
+        template<Piece_t piece, Flag_t flags>
+        static bool fits(BB from, BB to) {
+            if constexpr (flags == MoveFlag::ShortCastling || flags == MoveFlag::LongCastling) {
+                return san.special == flags;
+            } else {
+                int square = singleBitOf(from);
+                return to == target && piece == san.piece
+                       && (isPromotion(flags) ? san.special == flags : san.special == MoveFlag::Silent)
+                       && (san.fromFile < 0 || fileOf(square) == san.fromFile) && (san.fromRank < 0 || rankOf(square) == san.fromRank);
+            }
+        }
+
+        // the successor is only made for the moves that fit, next() leaves the others unmade
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove(const Board &board, BB from, BB to) {
+            if(!fits<piece, flags>(from, to)) return;
+            matches++;
+            sources |= from;
+            result = packMove(from, to, flags);
+            Board nextBoard = board.getNextBoard<state, piece, flags>(from, to);
+            successor = getExtendedBoard<getNextState<state, flags>()>(nextBoard);
+        }
+
+        template<State nextState, int depth>
+        static void next([[maybe_unused]] Board& nextBoard) {}
+    };
+
+    thread_local SAN Decoder::san{};
+    thread_local BB Decoder::target{0};
+    thread_local int Decoder::matches{0};
+    thread_local BB Decoder::sources{0};
+    thread_local PackedMove Decoder::result{0};
+    thread_local ExtendedBoard Decoder::successor{};
+
+    // runs the decoder, the number of legal moves that fit the SAN move
+    inline int match(const ExtendedBoard& eboard, const SAN& san) {
+        Board board = eboard.board;
+        Decoder::san = san;
+        Decoder::target = san.to < 0 ? 0 : newMask(san.to);
+        Decoder::matches = 0;
+        Decoder::sources = 0;
+        Utils::run<Decoder, 1>(eboard.state_code, board);
+        return Decoder::matches;
+    }
+
+    /**
+     * Plays a SAN move: 'move' receives the move and 'position' the position after it.
+     * Returns false if the token is no SAN move or not exactly one legal move fits it.
+     */
+    inline bool play(ExtendedBoard& position, std::string_view token, PackedMove& move) {
+        SAN san;
+        if(!parseSAN(token, san) || match(position, san) != 1) return false;
+        move = Decoder::result;
+        position = Decoder::successor;
+        return true;
+    }
+
+    inline bool isInCheck(const ExtendedBoard& eboard) {
+        const Board& board = eboard.board;
+        bool white = eboard.state_code & 0b10000;
+        BB enemies = white ? board.allPieces<false>() : board.allPieces<true>();
+        return SEE::attackersTo(board, singleBitOf(white ? board.wKing : board.bKing), board.occ()) & enemies;
+    }
+
+    // the SAN of a legal move of the position, with the file and / or rank of the piece only where they are needed
+    inline std::string toSAN(const ExtendedBoard& eboard, PackedMove move) {
+        int from = packedFrom(move), to = packedTo(move);
+        Flag_t flags = packedFlags(move);
+        std::string text;
+        if(flags == MoveFlag::ShortCastling) text = "O-O";
+        else if(flags == MoveFlag::LongCastling) text = "O-O-O";
+        else {
+            const Board& board = eboard.board;
+            Piece_t piece = eboard.state_code & 0b10000 ? board.pieceAt<true>(newMask(from)) : board.pieceAt<false>(newMask(from));
+            bool capture = hasBitAt(board.occ(), to) || flags == MoveFlag::EnPassantCapture;
+
+            SAN san{ piece, to, -1, -1, isPromotion(flags) ? flags : MoveFlag::Silent };
+            match(eboard, san);
+            BB others = Decoder::sources & ~newMask(from);
+            if(piece == Piece::Pawn) {
+                if(capture) text += static_cast<char>('a' + fileOf(from));
+            } else {
+                text += PIECE_LETTERS[piece];
+                bool sameFile = others & (fileA << fileOf(from)), sameRank = others & (rank1 << 8 * rankOf(from));
+                if(others && (!sameFile || sameRank)) text += static_cast<char>('a' + fileOf(from));
+                if(sameFile) text += static_cast<char>('1' + rankOf(from));
+            }
+            if(capture) text += 'x';
+            text += static_cast<char>('a' + fileOf(to));
+            text += static_cast<char>('1' + rankOf(to));
+            if(isPromotion(flags)) {
+                text += '=';
+                text += "?QRBN"[flags - MoveFlag::PromoteQueen + 1];
+            }
+        }
+
+        ExtendedBoard next;
+        SAN san;
+        parseSAN(text, san);
+        match(eboard, san);
+        next = Decoder::successor;
+        if(isInCheck(next)) text += GameState::isCheckmate(next) ? '#' : '+';
+        return text;
+    }
+
+    // a game of a PGN text: the tag pairs and the moves as they are in the text
+    struct Game {
+        std::string_view tags, movetext;
+        size_t offset{0};   // of the game in the text
+
+        // the value of a tag pair, e.g. tag("White"), empty if the game has no such tag
+        [[nodiscard]] std::string_view tag(std::string_view name) const {
+            for(size_t pos = tags.find('['); pos != std::string_view::npos; pos = tags.find('[', pos + 1)) {
+                if(tags.substr(pos + 1, name.size()) != name || tags.substr(pos + 1 + name.size(), 2) != " \"") continue;
+                size_t first = pos + name.size() + 3;
+                size_t last = tags.find('"', first);
+                return last == std::string_view::npos ? std::string_view{} : tags.substr(first, last - first);
+            }
+            return {};
+        }
+    };
+
+    constexpr bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    /**
+     * The next move of the movetext from pos on, empty at the end of the game. Comments, variations, numeric
+     * annotation glyphs, escaped lines and move numbers are skipped, the game ends with its result.
+     */
+    constexpr std::string_view nextMove(std::string_view text, size_t& pos) {
+        while(pos < text.size()) {
+            char c = text[pos];
+            if(isSpace(c) || c == ')') {
+                pos++;
+            } else if(c == '{') {
+                size_t close = text.find('}', pos);
+                pos = close == std::string_view::npos ? text.size() : close + 1;
+            } else if(c == ';' || (c == '%' && (pos == 0 || text[pos - 1] == '\n'))) {
+                pos = std::min(text.find('\n', pos), text.size());
+            } else if(c == '(') {
+                // variations nest, and may contain comments with parentheses
+                for(int depth = 0; pos < text.size(); pos++) {
+                    if(text[pos] == '{') pos = std::min(text.find('}', pos), text.size() - 1);
+                    else if(text[pos] == '(') depth++;
+                    else if(text[pos] == ')' && --depth == 0) break;
+                }
+                pos = std::min(pos + 1, text.size());
+            } else if(c == '$') {
+                for(pos++; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; pos++) {}
+            } else {
+                size_t first = pos;
+                while(pos < text.size() && !isSpace(text[pos]) && text[pos] != '{' && text[pos] != '(' && text[pos] != ')'
+                      && text[pos] != ';' && text[pos] != '$')
+                    pos++;
+                std::string_view word = text.substr(first, pos - first);
+                if(word == "1-0" || word == "0-1" || word == "1/2-1/2" || word == "*") {
+                    pos = text.size();
+                    return {};
+                }
+                // "12." and "12..." are move numbers, also when the move follows without a space
+                size_t digits = 0;
+                while(digits < word.size() && word[digits] >= '0' && word[digits] <= '9') digits++;
+                if(digits < word.size() && word[digits] == '.') word.remove_prefix(digits);
+                while(!word.empty() && word[0] == '.') word.remove_prefix(1);
+                if(!word.empty() && word != "e.p.") return word;
+            }
+        }
+        return {};
+    }
+
+    // a tag pair line that does not follow another one starts a game
+    constexpr bool startsGame(std::string_view text, size_t pos) {
+        if(pos == 0) return true;
+        if(text[pos] != '[' || text[pos - 1] != '\n') return false;
+        size_t previous = pos - 1;
+        while(previous > 0 && text[previous - 1] != '\n') previous--;
+        return text[previous] != '[';
+    }
+
+    // the start of the first game at or after pos, the size of the text if there is none
+    constexpr size_t nextGame(std::string_view text, size_t pos) {
+        while(pos < text.size() && !startsGame(text, pos)) {
+            pos = text.find('\n', pos);
+            if(pos == std::string_view::npos) return text.size();
+            pos++;
+        }
+        return std::min(pos, text.size());
+    }
+
+    // the game that starts at pos, pos moves on to the start of the next game
+    constexpr Game readGame(std::string_view text, size_t& pos) {
+        Game game;
+        game.offset = pos;
+        size_t end = pos;
+        while(end < text.size() && text[end] == '[') {
+            end = text.find('\n', end);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+        }
+        game.tags = text.substr(pos, end - pos);
+        pos = nextGame(text, end);
+        game.movetext = text.substr(end, pos - end);
+        return game;
+    }
+
+    /**
+     * Replays the game from the starting position or its FEN tag: visit(position, move, ply) is called for every
+     * position of the game with the move played in it, and with move 0 for the final position.
+     * Returns the first token that could not be played (or the FEN), empty if the whole game was replayed.
+     */
+    template<typename Visit>
+    std::string_view replay(const Game& game, Visit&& visit) {
+        ExtendedBoard position{ STARTBOARD, getStateCode<STARTSTATE>() };
+        std::string_view fen = game.tag("FEN");
+        if(!fen.empty()) {
+            try {
+                position = Utils::parseFEN(fen);
+            } catch(std::exception& ex) {
+                return fen;
+            }
+        }
+
+        size_t pos = 0;
+        int ply = 0;
+        for(std::string_view token = nextMove(game.movetext, pos); !token.empty(); token = nextMove(game.movetext, pos)) {
+            ExtendedBoard before = position;
+            PackedMove move;
+            if(!play(position, token, move)) return token;
+            visit(before, move, ply++);
+        }
+        visit(position, PackedMove{0}, ply);
+        return {};
+    }
+
+    struct Stats {
+        uint64_t games{0}, positions{0}, errors{0};
+        double seconds{0};
+        // the first game that could not be replayed, by its offset in the text, and the token that failed
+        size_t errorOffset{std::string_view::npos};
+        std::string errorToken;
+    };
+
+    constexpr size_t BLOCK_SIZE = 1 << 20;
+
+    /**
+     * Replays all games of the text on 'threads' threads, calling visit(thread, game, position, move, ply) for
+     * every position. The visitor is called from all threads at once, 'thread' (0 to threads - 1) lets it keep
+     * its results per thread. Games within a block are visited in order, blocks in no particular order.
+     */
+    template<typename Visit>
+    Stats replayAll(std::string_view text, unsigned threads, Visit visit) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        threads = std::max(1u, threads);
+        size_t blocks = (text.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        std::atomic<size_t> nextBlock{0};
+        std::vector<Stats> stats(threads);
+
+        auto run = [&](unsigned id) {
+            Stats& own = stats[id];
+            for(size_t block = nextBlock++; block < blocks; block = nextBlock++) {
+                size_t pos = nextGame(text, block * BLOCK_SIZE);
+                size_t end = nextGame(text, (block + 1) * BLOCK_SIZE);
+                while(pos < end) {
+                    Game game = readGame(text, pos);
+                    std::string_view failed = replay(game, [&](const ExtendedBoard& position, PackedMove move, int ply) {
+                        own.positions++;
+                        visit(id, game, position, move, ply);
+                    });
+                    own.games++;
+                    if(failed.empty()) continue;
+                    own.errors++;
+                    if(game.offset < own.errorOffset) {
+                        own.errorOffset = game.offset;
+                        own.errorToken = failed;
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> helpers;
+        for(unsigned id = 1; id < threads; id++) helpers.emplace_back(run, id);
+        run(0);
+        for(std::thread& helper: helpers) helper.join();
+
+        Stats total;
+        for(const Stats& s: stats) {
+            total.games += s.games;
+            total.positions += s.positions;
+            total.errors += s.errors;
+            if(s.errorOffset < total.errorOffset) {
+                total.errorOffset = s.errorOffset;
+                total.errorToken = s.errorToken;
+            }
+        }
+        std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - t1;
+        total.seconds = seconds.count();
+        return total;
+    }
+
+    // a PGN file mapped into memory
+    class Reader {
+        MappedFile file;
+
+    public:
+        // throws std::runtime_error if the file cannot be mapped
+        explicit Reader(const std::string& path) : file{path, false} {}
+
+        [[nodiscard]] std::string_view text() const {
+            return { reinterpret_cast<const char*>(file.data()), file.size() };
+        }
+
+        template<typename Visit>
+        Stats replay(unsigned threads, Visit visit) const {
+            return replayAll(text(), threads, visit);
+        }
+    };
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_PGN_H
@@ -3,11 +3,14 @@
 //
 
 #include <array>
+#include <vector>
 #include "chess.h"
 
 #ifndef DORY_PIECESTEPS_H
 #define DORY_PIECESTEPS_H
 
+DORY_NAMESPACE_BEGIN
+
 // used to terminate arrays that represent list of squares
 const uint8_t END_OF_ARRAY = 0x7f;
 
@@ -21,6 +24,9 @@ namespace PieceSteps {
 
     std::array<std::array<BB, 64>, 64> FROM_TO{};
 
+    // squares strictly between two squares on a common line, 0 if they are not aligned
+    std::array<std::array<BB, 64>, 64> BETWEEN{};
+
     template<bool>
     std::array<std::array<std::array<uint8_t, 8>, 4>, 64> STEPS{};
 
@@ -50,6 +56,7 @@ namespace PieceSteps {
             BB board = 0;
             j = i + off;
             while(0 <= j && j < 64 && manhattan(j-off, j) == manhattan_dist){
+                BETWEEN[i][j] = board;
                 board = withBit(board, j);
                 FROM_TO[i][j] = board;
                 STEPS<diag>[i][d][x++] = j;
@@ -84,6 +91,110 @@ namespace PieceSteps {
         KING_MOVES[index] = board;
     }
 
+    // sliding piece attacks by walking the rays, only used to fill the attack tables below
+    template<bool diag>
+    BB slideMaskByRays(BB occ, int index) {
+        BB mask = 0ull;
+        for(auto line: STEPS<diag>.at(index)) {
+            for(uint8_t sq: line) {
+                if(sq == END_OF_ARRAY) break;
+                setBit(mask, sq);
+                if(hasBitAt(occ, sq)) break;
+            }
+        }
+        return mask;
+    }
+
+    /*
+     * Sliding piece attacks are looked up in one table per piece type, indexed by the occupancy of the
+     * relevant squares (the rays without the board edge). With fast BMI2 the index is computed by PEXT,
+     * otherwise by magic multiplication. DORY_NO_PEXT forces the magics, e.g. for the Zen 1 and 2 CPUs
+     * where PEXT is microcoded.
+     */
+#if defined(__BMI2__) && !defined(DORY_NO_PEXT)
+    constexpr bool usePext = true;
+#else
+    constexpr bool usePext = false;
+#endif
+
+    struct SliderEntry {
+        BB mask{0}, magic{0};
+        uint32_t offset{0};
+        uint8_t shift{0};
+    };
+
+    template<bool diag>
+    std::array<SliderEntry, 64> SLIDERS{};
+
+    template<bool diag>
+    std::vector<BB> SLIDER_ATTACKS{};
+
+    inline uint64_t sliderIndex(const SliderEntry& entry, BB occ) {
+#if defined(__BMI2__) && !defined(DORY_NO_PEXT)
+        return _pext_u64(occ, entry.mask);
+#else
+        return ((occ & entry.mask) * entry.magic) >> entry.shift;
+#endif
+    }
+
+    template<bool diag>
+    void initSliderAttacks() {
+        std::array<BB, 4096> occupancies{}, attacks{};
+        std::array<int, 4096> epoch{};
+        uint64_t seed = 0x2545f4914f6cdd1d;
+        auto random = [&seed]() {
+            // xorshift64*, fixed seed so the magics are the same on every run
+            seed ^= seed >> 12; seed ^= seed << 25; seed ^= seed >> 27;
+            return seed * 0x2545f4914f6cdd1dull;
+        };
+
+        uint32_t offset = 0;
+        int attempt = 0;
+        for(int sq = 0; sq < 64; sq++) {
+            SliderEntry& entry = SLIDERS<diag>[sq];
+            // relevant squares: the rays without their last square
+            for(auto line: STEPS<diag>[sq])
+                for(int i = 0; line[i] != END_OF_ARRAY && line[i + 1] != END_OF_ARRAY; i++)
+                    setBit(entry.mask, line[i]);
+
+            int bits = bitCount(entry.mask);
+            int size = 1 << bits;
+            entry.offset = offset;
+            entry.shift = 64 - bits;
+            offset += size;
+            SLIDER_ATTACKS<diag>.resize(offset);
+
+            // enumerate all subsets of the mask (Carry-Rippler)
+            BB occ = 0;
+            for(int i = 0; i < size; i++) {
+                occupancies[i] = occ;
+                attacks[i] = slideMaskByRays<diag>(occ, sq);
+                occ = (occ - entry.mask) & entry.mask;
+            }
+
+            if constexpr (!usePext) {
+                // search a magic factor that maps all subsets without destructive collisions
+                for(bool found = false; !found;) {
+                    entry.magic = random() & random() & random();
+                    if(bitCount((entry.mask * entry.magic) >> 56) < 6) continue;
+                    attempt++;
+                    found = true;
+                    for(int i = 0; i < size && found; i++) {
+                        uint64_t index = sliderIndex(entry, occupancies[i]);
+                        BB& stored = SLIDER_ATTACKS<diag>[entry.offset + index];
+                        if(epoch[index] < attempt) {
+                            epoch[index] = attempt;
+                            stored = attacks[i];
+                        } else if(stored != attacks[i]) found = false;
+                    }
+                }
+            } else {
+                for(int i = 0; i < size; i++)
+                    SLIDER_ATTACKS<diag>[entry.offset + sliderIndex(entry, occupancies[i])] = attacks[i];
+            }
+        }
+    }
+
     void load() {
         if(!loaded) {
             for(int i = 0; i < 64; i++) {
@@ -92,22 +203,19 @@ namespace PieceSteps {
                 addKnightMoves(i);
                 addKingMoves(i);
             }
+            initSliderAttacks<true>();
+            initSliderAttacks<false>();
             loaded = true;
         }
     }
 
     template<bool diag>
-    BB slideMask(BB occ, int index) {
-        BB mask = 0ull;
-        for(auto line: STEPS<diag>.at(index)) {
-            for(uint8_t sq: line) {
-                if(sq == END_OF_ARRAY) break;
-                setBit(mask, sq);
-                if(hasBitAt(occ, sq)) break;
-            }
-        }
-        return mask;
+    inline BB slideMask(BB occ, int index) {
+        const SliderEntry& entry = SLIDERS<diag>[index];
+        return SLIDER_ATTACKS<diag>[entry.offset + sliderIndex(entry, occ)];
     }
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_PIECESTEPS_H
@@ -0,0 +1,226 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "mappedfile.h"
+#include "movegen.h"
+#include "utils.h"
+#include "fenreader.h"
+#include "zobrist.h"
+
+#ifndef DORY_POLYGLOT_H
+#define DORY_POLYGLOT_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Polyglot opening books: the Polyglot hash of a position and a reader for .bin books.
+ *
+ * The hash XORs entries of the 781 numbers of the Random64 array of the Polyglot format: one per piece kind and
+ * square, four castling rights, eight en passant files and the side to move. The array is part of the format but
+ * not of this tree, loadRandoms() reads it from a text file (e.g. the array as printed in the Polyglot
+ * documentation), and a table is only the real one if the starting position hashes to START_KEY.
+ */
+namespace Polyglot {
+
+    constexpr int NUM_RANDOMS = 781;
+    constexpr int CASTLING_OFFSET = 768, EN_PASSANT_OFFSET = 772, TURN_OFFSET = 780;
+    constexpr uint64_t START_KEY = 0x463b96181691fc9c;
+
+    using Randoms = std::array<uint64_t, NUM_RANDOMS>;
+
+    /**
+     * Reads the first 781 hexadecimal numbers with a 0x prefix from the file, separators and comments are ignored.
+     * Throws std::runtime_error if the file has fewer.
+     */
+    inline Randoms loadRandoms(const std::string& path) {
+        std::ifstream file{path};
+        if(!file) throw std::runtime_error("cannot open " + path);
+        std::stringstream text;
+        text << file.rdbuf();
+        std::string content = text.str();
+
+        Randoms randoms{};
+        int count = 0;
+        for(size_t pos = content.find("0x"); pos != std::string::npos && count < NUM_RANDOMS; pos = content.find("0x", pos + 2))
+            randoms[count++] = std::strtoull(content.c_str() + pos + 2, nullptr, 16);
+        if(count < NUM_RANDOMS) throw std::runtime_error(path + " holds " + std::to_string(count) + " of the 781 Polyglot numbers");
+        return randoms;
+    }
+
+    // black pawn 0, white pawn 1, black knight 2, ..., white king 11
+    constexpr int pieceKind(bool white, Piece_t piece) {
+        return 2 * (Piece::Pawn - piece) + white;
+    }
+
+    /**
+     * The Polyglot key of the position. Like Zobrist::hash, the en passant file only counts if a pawn of the side
+     * to move attacks the en passant square.
+     */
+    inline uint64_t hash(const Randoms& randoms, const Board& board, uint8_t state_code) {
+        uint64_t key = 0;
+        auto addPieces = [&](BB pieces, bool white, Piece_t piece) {
+            Bitloop(pieces) key ^= randoms[64 * pieceKind(white, piece) + firstBitOf(pieces)];
+        };
+        addPieces(board.wPawns, true, Piece::Pawn);     addPieces(board.bPawns, false, Piece::Pawn);
+        addPieces(board.wKnights, true, Piece::Knight); addPieces(board.bKnights, false, Piece::Knight);
+        addPieces(board.wBishops, true, Piece::Bishop); addPieces(board.bBishops, false, Piece::Bishop);
+        addPieces(board.wRooks, true, Piece::Rook);     addPieces(board.bRooks, false, Piece::Rook);
+        addPieces(board.wQueens, true, Piece::Queen);   addPieces(board.bQueens, false, Piece::Queen);
+        addPieces(board.wKing, true, Piece::King);      addPieces(board.bKing, false, Piece::King);
+
+        // white short, white long, black short, black long, the reverse order of the bits of the state code
+        for(int right = 0; right < 4; right++)
+            if(state_code & (0b1000 >> right)) key ^= randoms[CASTLING_OFFSET + right];
+
+        bool white = state_code & 0b10000;
+        if(white ? Zobrist::enPassantKey<true>(board) : Zobrist::enPassantKey<false>(board))
+            key ^= randoms[EN_PASSANT_OFFSET + fileOf(singleBitOf(board.enPassantField))];
+        if(white) key ^= randoms[TURN_OFFSET];
+        return key;
+    }
+
+    // an entry of a book file, stored big endian in 16 bytes
+    struct Entry {
+        uint64_t key;
+        uint16_t move, weight;
+        uint32_t learn;
+    };
+
+    // a book move together with the position it leads to
+    struct BookMove {
+        PackedMove move;
+        uint16_t weight;
+        ExtendedBoard next;
+    };
+
+    /**
+     * The Polyglot encoding of a Dory move: to square in bits 0-5, from square in bits 6-11 and the promotion piece
+     * (1 knight, 2 bishop, 3 rook, 4 queen) in bits 12-14. Castling is encoded as the king capturing its own rook.
+     */
+    constexpr uint16_t encode(int from, int to, Flag_t flags) {
+        if(flags == MoveFlag::ShortCastling) to += 1;
+        if(flags == MoveFlag::LongCastling) to -= 2;
+        int promotion = 0;
+        if(flags == MoveFlag::PromoteKnight) promotion = 1;
+        if(flags == MoveFlag::PromoteBishop) promotion = 2;
+        if(flags == MoveFlag::PromoteRook) promotion = 3;
+        if(flags == MoveFlag::PromoteQueen) promotion = 4;
+        return static_cast<uint16_t>(to | from << 6 | promotion << 12);
+    }
+
+    // finds the legal move of a position that has the given Polyglot encoding
+    struct Decoder {
+        static thread_local uint16_t move;
+        static thread_local bool matched, found;
+        static thread_local PackedMove result;
+        static thread_local ExtendedBoard successor;
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            MoveGenerator<Decoder>::template generate<state, 1>(board);
+        }
+
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove([[maybe_unused]] const Board &board, BB from, BB to) {
+            matched = !found && encode(singleBitOf(from), singleBitOf(to), flags) == move;
+            if(matched) result = packMove(from, to, flags);
+        }
+
+        template<State nextState, int depth>
+        static void next(Board& nextBoard) {
+            if(matched) {
+                successor = getExtendedBoard<nextState>(nextBoard);
+                found = true;
+            }
+        }
+    };
+
+    thread_local uint16_t Decoder::move{0};
+    thread_local bool Decoder::matched{false};
+    thread_local bool Decoder::found{false};
+    thread_local PackedMove Decoder::result{0};
+    thread_local ExtendedBoard Decoder::successor{};
+
+    /**
+     * Decodes a book move of the position into Dory's from / to / flags and plays it.
+     * Returns false if the position has no such legal move, e.g. because of a key collision.
+     */
+    inline bool decode(const ExtendedBoard& eboard, uint16_t bookMove, PackedMove& move, ExtendedBoard& next) {
+        Board board = eboard.board;
+        Decoder::move = bookMove;
+        Decoder::found = false;
+        Utils::run<Decoder, 1>(eboard.state_code, board);
+        if(!Decoder::found) return false;
+        move = Decoder::result;
+        next = Decoder::successor;
+        return true;
+    }
+
+    /**
+     * A Polyglot book mapped into memory read-only. Lookups binary search the entries, which are sorted by key in
+     * the file, so that only the pages touched by the search are ever read from disk.
+     */
+    class Book {
+        MappedFile file;
+
+        static constexpr size_t ENTRY_SIZE = 16;
+
+        static uint64_t readBigEndian(const unsigned char* p, int length) {
+            uint64_t value = 0;
+            for(int i = 0; i < length; i++) value = value << 8 | p[i];
+            return value;
+        }
+
+    public:
+        // throws std::runtime_error if the file cannot be mapped
+        explicit Book(const std::string& path) : file{path} {}
+
+        [[nodiscard]] size_t size() const {
+            return file.size() / ENTRY_SIZE;
+        }
+
+        [[nodiscard]] Entry entry(size_t i) const {
+            const unsigned char* p = file.data() + i * ENTRY_SIZE;
+            return { readBigEndian(p, 8), static_cast<uint16_t>(readBigEndian(p + 8, 2)),
+                     static_cast<uint16_t>(readBigEndian(p + 10, 2)), static_cast<uint32_t>(readBigEndian(p + 12, 4)) };
+        }
+
+        // all entries with the given key, in file order (Polyglot writers sort them by descending weight)
+        [[nodiscard]] std::vector<Entry> probe(uint64_t key) const {
+            size_t low = 0, high = size();
+            while(low < high) {
+                size_t middle = low + (high - low) / 2;
+                if(entry(middle).key < key) low = middle + 1;
+                else high = middle;
+            }
+            std::vector<Entry> entries;
+            for(size_t i = low; i < size() && entry(i).key == key; i++) entries.push_back(entry(i));
+            return entries;
+        }
+
+        // the legal book moves of the position, entries that do not decode to a legal move are skipped
+        [[nodiscard]] std::vector<BookMove> moves(const Randoms& randoms, const ExtendedBoard& eboard) const {
+            std::vector<BookMove> result;
+            for(const Entry& e: probe(hash(randoms, eboard.board, eboard.state_code))) {
+                BookMove bookMove{ 0, e.weight, {} };
+                if(decode(eboard, e.move, bookMove.move, bookMove.next)) result.push_back(bookMove);
+            }
+            return result;
+        }
+    };
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_POLYGLOT_H
@@ -0,0 +1,131 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <array>
+#include <cstdio>
+#include <x86intrin.h>
+#include "isa.h"
+
+#ifndef DORY_PROFILING_H
+#define DORY_PROFILING_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Cycle counts of the stages of move generation, per stage and ply.
+ *
+ * A collector turns profiling on by declaring 'static constexpr bool profile = true;'. For all other collectors
+ * the scopes in MoveGenerator are empty objects and compile to nothing.
+ * Time is attributed exclusively: entering a stage pauses the enclosing one, so the time spent generating
+ * the subtree below a move counts towards the stages of the deeper plies, not the stage that produced the move.
+ */
+namespace Profiling {
+
+    enum Stage : uint8_t {
+        Reload, Pawns, Knights, Bishops, Rooks, Queens, Castles, King, NextBoard, Collector, NUM_STAGES
+    };
+
+    constexpr std::array<const char*, NUM_STAGES> STAGE_NAMES{
+        "reload", "pawnMoves", "knightMoves", "bishopMoves", "rookMoves", "queenMoves", "castles", "kingMoves",
+        "getNextBoard", "collector"
+    };
+
+    // indexed by the remaining depth of the generate call
+    constexpr int MAX_DEPTH = 16;
+
+    struct Counters {
+        std::array<std::array<uint64_t, NUM_STAGES>, MAX_DEPTH> cycles{}, calls{};
+        Stage stage{Collector};
+        int depth{0};
+        uint64_t last{0};
+    };
+
+    thread_local Counters counters;
+
+    template<typename MoveCollector>
+    constexpr bool enabled = requires { requires MoveCollector::profile; };
+
+    inline void charge(uint64_t now) {
+        counters.cycles[counters.depth][counters.stage] += now - counters.last;
+        counters.last = now;
+    }
+
+    template<bool active>
+    class Scope {
+    public:
+        Scope(Stage, int) {}
+    };
+
+    template<>
+    class Scope<true> {
+        Stage outerStage;
+        int outerDepth;
+
+    public:
+        Scope(Stage stage, int depth) : outerStage{counters.stage}, outerDepth{counters.depth} {
+            charge(__rdtsc());
+            counters.stage = stage;
+            counters.depth = depth;
+            counters.calls[depth][stage]++;
+        }
+
+        ~Scope() {
+            charge(__rdtsc());
+            counters.stage = outerStage;
+            counters.depth = outerDepth;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    void reset() {
+        counters = {};
+        counters.last = __rdtsc();
+    }
+
+    /**
+     * Prints the cycles and calls per stage, followed by the share of every stage per ply.
+     * Cycles spent outside of any stage (e.g. in the root call) count as collector time of depth 0.
+     */
+    void print(int rootDepth) {
+        charge(__rdtsc());
+        std::array<uint64_t, NUM_STAGES> cycles{}, calls{};
+        uint64_t total = 0;
+        for(int depth = 0; depth < MAX_DEPTH; depth++) {
+            for(int stage = 0; stage < NUM_STAGES; stage++) {
+                cycles[stage] += counters.cycles[depth][stage];
+                calls[stage] += counters.calls[depth][stage];
+                total += counters.cycles[depth][stage];
+            }
+        }
+        if(total == 0) return;
+
+        std::printf("%-14s %14s %16s %8s %12s\n", "stage", "calls", "cycles", "share", "cycles/call");
+        for(int stage = 0; stage < NUM_STAGES; stage++) {
+            std::printf("%-14s %14llu %16llu %7.2f%% %12.1f\n", STAGE_NAMES[stage],
+                        static_cast<unsigned long long>(calls[stage]), static_cast<unsigned long long>(cycles[stage]),
+                        100.0 * static_cast<double>(cycles[stage]) / static_cast<double>(total),
+                        calls[stage] ? static_cast<double>(cycles[stage]) / static_cast<double>(calls[stage]) : 0.0);
+        }
+
+        std::printf("\n%-4s %8s", "ply", "share");
+        for(int stage = 0; stage < NUM_STAGES; stage++) std::printf(" %12s", STAGE_NAMES[stage]);
+        std::printf("\n");
+        for(int depth = rootDepth; depth > 0 && depth < MAX_DEPTH; depth--) {
+            uint64_t plyTotal = 0;
+            for(uint64_t c: counters.cycles[depth]) plyTotal += c;
+            if(plyTotal == 0) continue;
+            std::printf("%-4d %7.2f%%", rootDepth - depth + 1, 100.0 * static_cast<double>(plyTotal) / static_cast<double>(total));
+            for(uint64_t c: counters.cycles[depth])
+                std::printf(" %11.2f%%", 100.0 * static_cast<double>(c) / static_cast<double>(plyTotal));
+            std::printf("\n");
+        }
+        std::printf("\n");
+    }
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_PROFILING_H
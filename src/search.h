@@ -0,0 +1,293 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "moveordering.h"
+#include "gamestate.h"
+#include "see.h"
+#include "transpositiontable.h"
+#include "zobrist.h"
+
+#ifndef DORY_SEARCH_H
+#define DORY_SEARCH_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * A minimal fixed depth alpha-beta search on top of MoveGenerator, mainly to measure move ordering:
+ * with a material only evaluation the score does not depend on the order of the moves, the number of
+ * visited nodes does.
+ */
+namespace Search {
+
+    constexpr int MATE = 1'000'000;
+    constexpr int INFINITE = MATE + 1;
+    // scores beyond this are mates, their distance to the root is converted to the distance to the node in the table
+    constexpr int MATE_BOUND = MATE - 1000;
+
+    constexpr int toTable(int score, int ply) {
+        return score > MATE_BOUND ? score + ply : score < -MATE_BOUND ? score - ply : score;
+    }
+
+    constexpr int fromTable(int score, int ply) {
+        return score > MATE_BOUND ? score - ply : score < -MATE_BOUND ? score + ply : score;
+    }
+
+    template<bool white>
+    constexpr int material(const Board& board) {
+        using MoveOrdering::PIECE_VALUES;
+        return PIECE_VALUES[Piece::Pawn] * bitCount(board.pawns<white>())
+             + PIECE_VALUES[Piece::Knight] * bitCount(board.knights<white>())
+             + PIECE_VALUES[Piece::Bishop] * bitCount(board.bishops<white>())
+             + PIECE_VALUES[Piece::Rook] * bitCount(board.rooks<white>())
+             + PIECE_VALUES[Piece::Queen] * bitCount(board.queens<white>());
+    }
+
+    // from the point of view of the side to move
+    template<State state>
+    constexpr int evaluate(const Board& board) {
+        return material<state.whiteToMove>(board) - material<!state.whiteToMove>(board);
+    }
+
+    struct Result {
+        int score;
+        PackedMove best;
+        unsigned long long nodes, qnodes;     // qnodes: the part of 'nodes' in the quiescence search
+    };
+
+    /**
+     * Negamax alpha-beta search. Every node generates all of its moves into a MoveList on the stack and then
+     * searches the successors, in generation order or, if 'ordered', by MVV-LVA, killer moves and history.
+     * Killers and history are kept between calls of search(), so that iterative deepening profits from them.
+     * At depth 0 a quiescence search resolves the pending captures: it generates captures and promotions only
+     * and skips captures that lose material according to SEE. Its moves are always ordered by MVV-LVA.
+     * Unlike the perft collectors the remaining depth is a runtime value, so that there is a single node
+     * function per State instead of one per State and depth. Ordering is a runtime switch for the same reason.
+     * All state of a search is thread local, only the transposition table (none by default, see LazySMP) is shared.
+     */
+    class AlphaBeta {
+    public:
+        static Result search(const ExtendedBoard& eboard, int depth, bool ordered = true) {
+            Board board = eboard.board;
+            nodes = 0;
+            qnodes = 0;
+            best = 0;
+            AlphaBeta::ordered = ordered;
+            rootDepth = std::min(depth, MoveOrdering::MAX_PLY - 1);
+            Utils::run<AlphaBeta, 1>(eboard.state_code, board);
+            return { score, best, nodes, qnodes };
+        }
+
+        static void clear() {
+            killers.clear();
+            history.clear();
+        }
+
+        template<State state, int depth>
+        static void main(Board& board) {
+            score = node<state>(board, rootDepth, -INFINITE, INFINITE, 0);
+        }
+
+    private:
+        struct Child : MoveOrdering::ScoredMove {
+            Board board;
+            int (*search)(Board&, int depth, int alpha, int beta, int ply);
+        };
+
+        static constexpr int TABLE_MOVE_SCORE = 1 << 30;
+
+        static TranspositionTable* table;
+        static std::atomic<bool> stopped;
+        static thread_local MoveOrdering::MoveList<Child>* children;
+        static thread_local MoveOrdering::Killers killers;
+        static thread_local MoveOrdering::History history;
+        static thread_local unsigned long long nodes, qnodes;
+        static thread_local int score, rootDepth;
+        static thread_local PackedMove best;
+        static thread_local bool ordered;
+
+        template<State state>
+        static int node(Board& board, int depth, int alpha, int beta, int ply) {
+            // the result of a stopped search is discarded
+            if(stopped.load(std::memory_order_relaxed)) return 0;
+            if(depth == 0) return quiescence<state>(board, depth, alpha, beta, ply);
+            nodes++;
+
+            uint64_t key = 0;
+            PackedMove tableMove = 0;
+            if(table) {
+                key = Zobrist::hash(board, getStateCode<state>());
+                TranspositionTable::Data entry;
+                if(table->probe(key, entry)) {
+                    tableMove = entry.move;
+                    int value = fromTable(entry.score, ply);
+                    if(ply > 0 && entry.depth >= depth && (entry.bound == TranspositionTable::Exact
+                            || (entry.bound == TranspositionTable::Lower && value >= beta)
+                            || (entry.bound == TranspositionTable::Upper && value <= alpha)))
+                        return std::clamp(value, alpha, beta);
+                }
+            }
+
+            MoveOrdering::MoveList<Child> list;
+            MoveOrdering::MoveList<Child>* parent = std::exchange(children, &list);
+            MoveGenerator<Expand<false>>::template generate<state, 1>(board);
+            children = parent;
+
+            if(list.empty()) {
+                PinData pd = CheckLogicHandler::reload<state>(board);
+                return GameState::isInCheck(pd) ? -MATE + ply : 0;
+            }
+
+            if(ordered) {
+                list.score(state.whiteToMove, ply, killers, history);
+                for(int i = 0; tableMove && i < list.size(); i++)
+                    if(list[i].move == tableMove) list[i].score = TABLE_MOVE_SCORE;
+            }
+
+            PackedMove bestMove = 0;
+            for(int i = 0; i < list.size(); i++) {
+                Child& child = ordered ? list.pick(i) : list[i];
+                int value = -child.search(child.board, depth - 1, -beta, -alpha, ply + 1);
+                if(value >= beta) {
+                    if(ordered && !child.captured && !isPromotion(packedFlags(child.move))) {
+                        killers.store(ply, child.move);
+                        history.update(state.whiteToMove, child.move, depth);
+                    }
+                    store(key, beta, child.move, depth, TranspositionTable::Lower, ply);
+                    return beta;
+                }
+                if(value > alpha) {
+                    alpha = value;
+                    bestMove = child.move;
+                    if(ply == 0) best = child.move;
+                }
+            }
+            store(key, alpha, bestMove, depth, bestMove ? TranspositionTable::Exact : TranspositionTable::Upper, ply);
+            return alpha;
+        }
+
+        static void store(uint64_t key, int score, PackedMove move, int depth, TranspositionTable::Bound bound, int ply) {
+            if(table && !stopped.load(std::memory_order_relaxed))
+                table->store(key, { toTable(score, ply), move, static_cast<uint8_t>(depth), bound });
+        }
+
+        template<State state>
+        static int quiescence(Board& board, [[maybe_unused]] int depth, int alpha, int beta, int ply) {
+            nodes++;
+            qnodes++;
+            // the side to move is not forced to capture
+            int standPat = evaluate<state>(board);
+            if(standPat >= beta) return beta;
+            if(standPat > alpha) alpha = standPat;
+
+            MoveOrdering::MoveList<Child> list;
+            MoveOrdering::MoveList<Child>* parent = std::exchange(children, &list);
+            MoveGenerator<Expand<true>>::template generate<state, 1>(board);
+            children = parent;
+
+            // always by MVV-LVA, without it the quiescence search explodes. All moves are captures or promotions,
+            // so the killers and the history are never consulted.
+            list.score(state.whiteToMove, ply, killers, history);
+            for(int i = 0; i < list.size(); i++) {
+                Child& child = list.pick(i);
+                Flag_t flags = packedFlags(child.move);
+                if(!isPromotion(flags) && SEE::evaluate<state.whiteToMove>(board, newMask(packedFrom(child.move)),
+                                                                           newMask(packedTo(child.move)), flags) < 0) continue;
+
+                int value = -child.search(child.board, 0, -beta, -alpha, ply + 1);
+                if(value >= beta) return beta;
+                if(value > alpha) alpha = value;
+            }
+            return alpha;
+        }
+
+        // the collector filling the MoveList of the current node, with captures and promotions only in quiescence
+        template<bool quiescent>
+        struct Expand {
+            static constexpr bool capturesOnly = quiescent;
+
+            template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+            static void registerMove(const Board &board, BB from, BB to) {
+                Child& child = children->add();
+                child.move = packMove(from, to, flags);
+                child.piece = piece;
+                child.captured = MoveOrdering::victim<state, flags>(board, to);
+            }
+
+            template<State nextState, int depth>
+            static void next(Board& nextBoard) {
+                Child& child = children->back();
+                child.board = nextBoard;
+                child.search = quiescent ? &quiescence<nextState> : &node<nextState>;
+            }
+        };
+
+        friend class LazySMP;
+    };
+
+    TranspositionTable* AlphaBeta::table{nullptr};
+    std::atomic<bool> AlphaBeta::stopped{false};
+    thread_local MoveOrdering::MoveList<AlphaBeta::Child>* AlphaBeta::children{nullptr};
+    thread_local MoveOrdering::Killers AlphaBeta::killers{};
+    thread_local MoveOrdering::History AlphaBeta::history{};
+    thread_local unsigned long long AlphaBeta::nodes{0};
+    thread_local unsigned long long AlphaBeta::qnodes{0};
+    thread_local int AlphaBeta::score{0};
+    thread_local int AlphaBeta::rootDepth{0};
+    thread_local PackedMove AlphaBeta::best{0};
+    thread_local bool AlphaBeta::ordered{true};
+
+    /**
+     * Lazy SMP: all threads run iterative deepening on the same root and only communicate through the shared
+     * transposition table, which makes them search different parts of the tree. Every other helper starts one
+     * depth ahead so that they do not move in lockstep.
+     * The search ends as soon as the main thread completed 'depth', its result is returned with the nodes of all threads.
+     */
+    class LazySMP {
+    public:
+        static Result search(const ExtendedBoard& eboard, int depth, unsigned threads, TranspositionTable& table) {
+            table.newSearch();
+            AlphaBeta::table = &table;
+            AlphaBeta::stopped = false;
+
+            Result result{};
+            std::atomic<unsigned long long> nodes{0}, qnodes{0};
+            auto worker = [&](unsigned id) {
+                AlphaBeta::clear();
+                Result last{};
+                unsigned long long own = 0, ownQ = 0;
+                for(int d = 1 + (id % 2); d <= depth && !AlphaBeta::stopped.load(std::memory_order_relaxed); d++) {
+                    last = AlphaBeta::search(eboard, d);
+                    own += last.nodes;
+                    ownQ += last.qnodes;
+                }
+                if(id == 0) {
+                    AlphaBeta::stopped = true;
+                    result = last;
+                }
+                nodes += own;
+                qnodes += ownQ;
+            };
+
+            std::vector<std::thread> helpers;
+            for(unsigned id = 1; id < threads; id++) helpers.emplace_back(worker, id);
+            worker(0);
+            for(std::thread& helper: helpers) helper.join();
+
+            AlphaBeta::table = nullptr;
+            AlphaBeta::stopped = false;
+            result.nodes = nodes;
+            result.qnodes = qnodes;
+            return result;
+        }
+    };
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_SEARCH_H
@@ -0,0 +1,108 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <algorithm>
+#include <array>
+#include "board.h"
+#include "piecesteps.h"
+#include "moveordering.h"
+
+#ifndef DORY_SEE_H
+#define DORY_SEE_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Static exchange evaluation: the material balance of the capture sequence on a single square, in which both
+ * sides always recapture with their least valuable attacker and may stop whenever continuing would lose material.
+ * Pins and checks are ignored, as usual for SEE.
+ */
+namespace SEE {
+
+    // pawns of the given color that attack the square
+    template<bool white>
+    constexpr BB pawnAttackersTo(const Board& board, BB square) {
+        return board.pawns<white>() & ((pawnInvAtkLeft<white>(square) & pawnCanGoLeft<white>())
+                                     | (pawnInvAtkRight<white>(square) & pawnCanGoRight<white>()));
+    }
+
+    /**
+     * All pieces of both colors that attack the square when the occupancy is 'occ'.
+     * Pieces that are not in 'occ' still count, the caller masks them out if they have been captured already.
+     */
+    inline BB attackersTo(const Board& board, int square, BB occ) {
+        BB diagonal = board.bishops<true>() | board.bishops<false>() | board.queens<true>() | board.queens<false>();
+        BB straight = board.rooks<true>() | board.rooks<false>() | board.queens<true>() | board.queens<false>();
+        BB squareBB = newMask(square);
+        return pawnAttackersTo<true>(board, squareBB) | pawnAttackersTo<false>(board, squareBB)
+             | (PieceSteps::KNIGHT_MOVES[square] & (board.knights<true>() | board.knights<false>()))
+             | (PieceSteps::KING_MOVES[square] & (board.king<true>() | board.king<false>()))
+             | (PieceSteps::slideMask<true>(occ, square) & diagonal)
+             | (PieceSteps::slideMask<false>(occ, square) & straight);
+    }
+
+    // the least valuable of the attackers of the given color, 0 if there is none
+    template<bool white>
+    constexpr BB leastValuable(const Board& board, BB attackers, Piece_t& piece) {
+        if(BB bb = attackers & board.pawns<white>())   { piece = Piece::Pawn;   return isolateLowestBit(bb); }
+        if(BB bb = attackers & board.knights<white>()) { piece = Piece::Knight; return isolateLowestBit(bb); }
+        if(BB bb = attackers & board.bishops<white>()) { piece = Piece::Bishop; return isolateLowestBit(bb); }
+        if(BB bb = attackers & board.rooks<white>())   { piece = Piece::Rook;   return isolateLowestBit(bb); }
+        if(BB bb = attackers & board.queens<white>())  { piece = Piece::Queen;  return isolateLowestBit(bb); }
+        if(BB bb = attackers & board.king<white>())    { piece = Piece::King;   return bb; }
+        return 0;
+    }
+
+    /**
+     * Material won by the side 'white' with the capture (or quiet move) from - to, in the piece values of
+     * MoveOrdering::PIECE_VALUES. Promotions are scored like the pawn move they are.
+     * Sliders behind the pieces that took part in the exchange join it as soon as their line opens (x-rays).
+     */
+    template<bool white>
+    int evaluate(const Board& board, BB from, BB to, Flag_t flags = MoveFlag::Silent) {
+        using MoveOrdering::PIECE_VALUES;
+        const int square = singleBitOf(to);
+        const BB diagonal = board.bishops<true>() | board.bishops<false>() | board.queens<true>() | board.queens<false>();
+        const BB straight = board.rooks<true>() | board.rooks<false>() | board.queens<true>() | board.queens<false>();
+
+        BB occ = board.occ();
+        std::array<int, 32> gain{};
+        int d = 0;
+        if(flags == MoveFlag::EnPassantCapture) {
+            gain[0] = PIECE_VALUES[Piece::Pawn];
+            occ ^= backward<white>(to);
+        } else {
+            gain[0] = PIECE_VALUES[board.pieceAt<!white>(to)];
+        }
+
+        Piece_t piece = board.pieceAt<white>(from);
+        BB attackers = attackersTo(board, square, occ);
+        bool side = white;
+        while(true) {
+            // the piece that just captured leaves its square, which may open a line for a slider behind it
+            occ ^= from;
+            if(piece == Piece::Pawn || piece == Piece::Bishop || piece == Piece::Queen)
+                attackers |= PieceSteps::slideMask<true>(occ, square) & diagonal;
+            if(piece == Piece::Rook || piece == Piece::Queen)
+                attackers |= PieceSteps::slideMask<false>(occ, square) & straight;
+            attackers &= occ;
+
+            int victim = PIECE_VALUES[piece];
+            side = !side;
+            from = side ? leastValuable<true>(board, attackers, piece) : leastValuable<false>(board, attackers, piece);
+            if(!from) break;
+
+            d++;
+            gain[d] = victim - gain[d - 1];
+        }
+
+        // every side may stop capturing instead of continuing the sequence
+        while(d--) gain[d] = std::min(gain[d], -gain[d + 1]);
+        return gain[0];
+    }
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_SEE_H
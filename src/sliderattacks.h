@@ -0,0 +1,149 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include "piecesteps.h"
+
+#ifndef DORY_SLIDERATTACKS_H
+#define DORY_SLIDERATTACKS_H
+
+DORY_NAMESPACE_BEGIN
+
+/*
+ * Kernels computing all squares attacked by the sliding pieces of one side, used by CheckLogicHandler::reload.
+ * Every kernel provides
+ *
+ *      static BB attacks(BB diagonal, BB straight, BB occ);
+ *
+ * where 'diagonal' are the bishops and queens, 'straight' the rooks and queens and 'occ' the blocking pieces.
+ *
+ * PerPiece looks up the attacks of every slider separately, the Kogge-Stone kernels fill all pieces of a
+ * direction at once with parallel prefix (occluded) fills, so their cost does not depend on the number of sliders.
+ * The vector versions process the eight directions in the lanes of an AVX2 / AVX-512 register.
+ */
+namespace SliderAttacks {
+
+    struct PerPiece {
+        static BB attacks(BB diagonal, BB straight, BB occ) {
+            BB mask = 0;
+            Bitloop(diagonal) mask |= PieceSteps::slideMask<true>(occ, firstBitOf(diagonal));
+            Bitloop(straight) mask |= PieceSteps::slideMask<false>(occ, firstBitOf(straight));
+            return mask;
+        }
+    };
+
+    // squares that may be entered by a step in each direction without wrapping around the board
+    constexpr BB notFileA = ~fileA, notFileH = ~fileH;
+
+    struct KoggeStone {
+        template<int shift>
+        static constexpr BB step(BB bb) {
+            if constexpr (shift > 0) return bb << shift;
+            else return bb >> -shift;
+        }
+
+        template<int shift, BB wrap>
+        static constexpr BB fill(BB gen, BB empty) {
+            BB pro = empty & wrap;
+            gen |= pro & step<shift>(gen);
+            pro &= step<shift>(pro);
+            gen |= pro & step<2 * shift>(gen);
+            pro &= step<2 * shift>(pro);
+            gen |= pro & step<4 * shift>(gen);
+            return step<shift>(gen) & wrap;
+        }
+
+        static BB attacks(BB diagonal, BB straight, BB occ) {
+            BB empty = ~occ;
+            return fill<8, FULL_BB>(straight, empty) | fill<-8, FULL_BB>(straight, empty)
+                 | fill<1, notFileA>(straight, empty) | fill<-1, notFileH>(straight, empty)
+                 | fill<9, notFileA>(diagonal, empty) | fill<-9, notFileH>(diagonal, empty)
+                 | fill<7, notFileH>(diagonal, empty) | fill<-7, notFileA>(diagonal, empty);
+        }
+    };
+
+#ifdef __AVX2__
+    // lanes: north, north east, east, north west (shifted left) and south, south west, west, south east (shifted right)
+    struct KoggeStoneAVX2 {
+        static BB attacks(BB diagonal, BB straight, BB occ) {
+            const __m256i shift1 = _mm256_setr_epi64x(8, 9, 1, 7);
+            const __m256i shift2 = _mm256_slli_epi64(shift1, 1);
+            const __m256i shift4 = _mm256_slli_epi64(shift1, 2);
+            const __m256i wrapUp = _mm256_setr_epi64x(FULL_BB, notFileA, notFileA, notFileH);
+            const __m256i wrapDown = _mm256_setr_epi64x(FULL_BB, notFileH, notFileH, notFileA);
+
+            __m256i empty = _mm256_set1_epi64x(~occ);
+            __m256i up = _mm256_setr_epi64x(straight, diagonal, straight, diagonal);
+            __m256i down = up;
+            __m256i proUp = _mm256_and_si256(empty, wrapUp);
+            __m256i proDown = _mm256_and_si256(empty, wrapDown);
+
+            up = _mm256_or_si256(up, _mm256_and_si256(proUp, _mm256_sllv_epi64(up, shift1)));
+            down = _mm256_or_si256(down, _mm256_and_si256(proDown, _mm256_srlv_epi64(down, shift1)));
+            proUp = _mm256_and_si256(proUp, _mm256_sllv_epi64(proUp, shift1));
+            proDown = _mm256_and_si256(proDown, _mm256_srlv_epi64(proDown, shift1));
+
+            up = _mm256_or_si256(up, _mm256_and_si256(proUp, _mm256_sllv_epi64(up, shift2)));
+            down = _mm256_or_si256(down, _mm256_and_si256(proDown, _mm256_srlv_epi64(down, shift2)));
+            proUp = _mm256_and_si256(proUp, _mm256_sllv_epi64(proUp, shift2));
+            proDown = _mm256_and_si256(proDown, _mm256_srlv_epi64(proDown, shift2));
+
+            up = _mm256_or_si256(up, _mm256_and_si256(proUp, _mm256_sllv_epi64(up, shift4)));
+            down = _mm256_or_si256(down, _mm256_and_si256(proDown, _mm256_srlv_epi64(down, shift4)));
+
+            up = _mm256_and_si256(_mm256_sllv_epi64(up, shift1), wrapUp);
+            down = _mm256_and_si256(_mm256_srlv_epi64(down, shift1), wrapDown);
+
+            __m256i all = _mm256_or_si256(up, down);
+            __m128i half = _mm_or_si128(_mm256_castsi256_si128(all), _mm256_extracti128_si256(all, 1));
+            return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+        }
+    };
+#endif
+
+#ifdef __AVX512F__
+    /*
+     * All eight directions in one register, lanes 4 to 7 are shifted right. Only masked (maskz) intrinsics are used,
+     * the unmasked ones pass an undefined vector that makes GCC 12 emit -Wuninitialized warnings.
+     */
+    struct KoggeStoneAVX512 {
+        static __m512i step(__m512i bb, __m512i shift) {
+            return _mm512_mask_srlv_epi64(_mm512_maskz_sllv_epi64(0x0f, bb, shift), 0xf0, bb, shift);
+        }
+
+        static BB attacks(BB diagonal, BB straight, BB occ) {
+            const __m512i shift1 = _mm512_setr_epi64(8, 9, 1, 7, 8, 9, 1, 7);
+            const __m512i shift2 = _mm512_setr_epi64(16, 18, 2, 14, 16, 18, 2, 14);
+            const __m512i shift4 = _mm512_setr_epi64(32, 36, 4, 28, 32, 36, 4, 28);
+            const __m512i wrap = _mm512_setr_epi64(FULL_BB, notFileA, notFileA, notFileH, FULL_BB, notFileH, notFileH, notFileA);
+
+            __m512i gen = _mm512_setr_epi64(straight, diagonal, straight, diagonal, straight, diagonal, straight, diagonal);
+            __m512i pro = _mm512_and_si512(_mm512_set1_epi64(~occ), wrap);
+
+            gen = _mm512_or_si512(gen, _mm512_and_si512(pro, step(gen, shift1)));
+            pro = _mm512_and_si512(pro, step(pro, shift1));
+            gen = _mm512_or_si512(gen, _mm512_and_si512(pro, step(gen, shift2)));
+            pro = _mm512_and_si512(pro, step(pro, shift2));
+            gen = _mm512_or_si512(gen, _mm512_and_si512(pro, step(gen, shift4)));
+
+            gen = _mm512_and_si512(step(gen, shift1), wrap);
+            __m256i all = _mm256_or_si256(_mm512_maskz_extracti64x4_epi64(0xf, gen, 0), _mm512_maskz_extracti64x4_epi64(0xf, gen, 1));
+            __m128i half = _mm_or_si128(_mm256_castsi256_si128(all), _mm256_extracti128_si256(all, 1));
+            return _mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1);
+        }
+    };
+#endif
+
+    // the widest Kogge-Stone kernel the target supports
+#if defined(__AVX512F__)
+    using Vector = KoggeStoneAVX512;
+#elif defined(__AVX2__)
+    using Vector = KoggeStoneAVX2;
+#else
+    using Vector = KoggeStone;
+#endif
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_SLIDERATTACKS_H
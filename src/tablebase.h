@@ -0,0 +1,721 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "board.h"
+#include "largepages.h"
+#include "mappedfile.h"
+#include "movegen.h"
+#include "piecesteps.h"
+#include "see.h"
+#include "utils.h"
+#include "fenreader.h"
+#include "zobrist.h"
+
+#ifndef DORY_TABLEBASE_H
+#define DORY_TABLEBASE_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Endgame tablebases with up to 5 pieces (kings included), built by retrograde analysis.
+ *
+ * A table holds the distance to mate (DTM, in plies) of every position of one material signature such as "KRPvKR",
+ * from the point of view of the side to move: odd distances are wins, even distances losses, draws have none.
+ * Tables are written to two files, <name>.dtm with 16 bits per position and <name>.wdl with 2 bits per position,
+ * which Tablebases maps into memory to probe them in O(1).
+ *
+ * Only the stronger side as white is stored (KQvKR, not KRvKQ), positions of the other color are probed with
+ * colors swapped. Castling rights and en passant captures are not part of the tables.
+ */
+namespace Tablebase {
+
+    constexpr int MAX_PIECES = 5;
+
+    // stored per position: 0 for a draw, INVALID for impossible or duplicate positions and the DTM + 1 otherwise
+    constexpr uint16_t DRAW = 0, INVALID = 0xffff;
+
+    enum WDL : uint8_t { Draw, Win, Loss, Invalid };
+
+    struct Result {
+        WDL wdl;
+        int dtm;    // plies to mate for wins and losses, 0 for draws
+    };
+
+    constexpr Result decode(uint16_t entry) {
+        if(entry == INVALID) return { Invalid, 0 };
+        if(entry == DRAW) return { Draw, 0 };
+        int dtm = entry - 1;
+        return { dtm % 2 ? Win : Loss, dtm };
+    }
+
+    // indexed by Piece_t
+    constexpr std::string_view PIECE_CHARS{"?KQRBNP"};
+
+    constexpr BB Board::* pieceField(bool white, Piece_t piece) {
+        switch(piece) {
+            case Piece::Queen:  return white ? &Board::wQueens : &Board::bQueens;
+            case Piece::Rook:   return white ? &Board::wRooks : &Board::bRooks;
+            case Piece::Bishop: return white ? &Board::wBishops : &Board::bBishops;
+            case Piece::Knight: return white ? &Board::wKnights : &Board::bKnights;
+            case Piece::Pawn:   return white ? &Board::wPawns : &Board::bPawns;
+            default:            return white ? &Board::wKing : &Board::bKing;
+        }
+    }
+
+    /**
+     * Number of pieces of every kind and color besides the kings, 3 bits each: white queens in bits 0-2,
+     * black queens in 3-5, white rooks in 6-8 and so on. Tables are looked up by this key.
+     */
+    inline uint32_t materialKey(const Board& board) {
+        uint32_t key = 0;
+        for(Piece_t piece = Piece::Queen; piece <= Piece::Pawn; piece++) {
+            key |= bitCount(board.*pieceField(true, piece)) << (6 * (piece - Piece::Queen));
+            key |= bitCount(board.*pieceField(false, piece)) << (6 * (piece - Piece::Queen) + 3);
+        }
+        return key;
+    }
+
+    constexpr uint32_t swappedKey(uint32_t key) {
+        uint32_t swapped = 0;
+        for(int kind = 0; kind < 5; kind++)
+            swapped |= ((key >> (6 * kind)) & 7) << (6 * kind + 3) | ((key >> (6 * kind + 3)) & 7) << (6 * kind);
+        return swapped;
+    }
+
+    // the pieces of a table besides the kings, strongest first
+    struct Material {
+        std::vector<Piece_t> white, black;
+
+        // e.g. "KRPvKR", throws std::invalid_argument for malformed names and more than MAX_PIECES pieces
+        static Material parse(std::string_view name) {
+            Material material;
+            size_t separator = name.find('v');
+            if(separator == std::string_view::npos) throw std::invalid_argument("material needs the form KQvK");
+            auto parseSide = [](std::string_view side, std::vector<Piece_t>& pieces) {
+                if(side.empty() || side[0] != 'K') throw std::invalid_argument("every side needs a king");
+                for(char c: side.substr(1)) {
+                    size_t piece = PIECE_CHARS.find(c);
+                    if(piece == std::string_view::npos || piece <= Piece::King) throw std::invalid_argument("invalid piece");
+                    pieces.push_back(static_cast<Piece_t>(piece));
+                }
+                std::sort(pieces.begin(), pieces.end());
+            };
+            parseSide(name.substr(0, separator), material.white);
+            parseSide(name.substr(separator + 1), material.black);
+            if(material.count() > MAX_PIECES) throw std::invalid_argument("at most 5 pieces");
+            return material;
+        }
+
+        static Material of(const Board& board) {
+            Material material;
+            for(Piece_t piece = Piece::Queen; piece <= Piece::Pawn; piece++) {
+                material.white.insert(material.white.end(), bitCount(board.*pieceField(true, piece)), piece);
+                material.black.insert(material.black.end(), bitCount(board.*pieceField(false, piece)), piece);
+            }
+            return material;
+        }
+
+        [[nodiscard]] std::string name() const {
+            std::string name{"K"};
+            for(Piece_t piece: white) name += PIECE_CHARS[piece];
+            name += "vK";
+            for(Piece_t piece: black) name += PIECE_CHARS[piece];
+            return name;
+        }
+
+        [[nodiscard]] int count() const {
+            return 2 + static_cast<int>(white.size() + black.size());
+        }
+
+        [[nodiscard]] bool hasPawns() const {
+            return std::count(white.begin(), white.end(), Piece::Pawn) + std::count(black.begin(), black.end(), Piece::Pawn) > 0;
+        }
+
+        // stored tables have at least as many and as strong pieces for white as for black
+        [[nodiscard]] bool isCanonical() const {
+            if(white.size() != black.size()) return white.size() > black.size();
+            return white <= black;
+        }
+
+        [[nodiscard]] Material swapped() const {
+            return { black, white };
+        }
+
+        [[nodiscard]] uint32_t key() const {
+            uint32_t key = 0;
+            for(Piece_t piece: white) key += 1u << (6 * (piece - Piece::Queen));
+            for(Piece_t piece: black) key += 1u << (6 * (piece - Piece::Queen) + 3);
+            return key;
+        }
+    };
+
+    // the mirror images of a bitboard, squares are numbered a1 = 0, h1 = 7, ..., h8 = 63
+    constexpr BB mirrorFiles(BB bb) {
+        bb = ((bb >> 1) & 0x5555555555555555) | ((bb & 0x5555555555555555) << 1);
+        bb = ((bb >> 2) & 0x3333333333333333) | ((bb & 0x3333333333333333) << 2);
+        return ((bb >> 4) & 0x0f0f0f0f0f0f0f0f) | ((bb & 0x0f0f0f0f0f0f0f0f) << 4);
+    }
+
+    constexpr BB mirrorRanks(BB bb) {
+        return __builtin_bswap64(bb);
+    }
+
+    // along the a1-h8 diagonal
+    constexpr BB transpose(BB bb) {
+        BB t = 0x0f0f0f0f00000000 & (bb ^ (bb << 28));
+        bb ^= t ^ (t >> 28);
+        t = 0x3333000033330000 & (bb ^ (bb << 14));
+        bb ^= t ^ (t >> 14);
+        t = 0x5500550055005500 & (bb ^ (bb << 7));
+        return bb ^ t ^ (t >> 7);
+    }
+
+    template<typename Transform>
+    Board transformed(const Board& board, Transform f) {
+        return { f(board.wPawns), f(board.bPawns), f(board.wKnights), f(board.bKnights), f(board.wBishops), f(board.bBishops),
+                 f(board.wRooks), f(board.bRooks), f(board.wQueens), f(board.bQueens), f(board.wKing), f(board.bKing), 0 };
+    }
+
+    // the same position with colors exchanged, seen from the other side of the board
+    inline Board swapColors(const Board& board) {
+        return { mirrorRanks(board.bPawns), mirrorRanks(board.wPawns), mirrorRanks(board.bKnights), mirrorRanks(board.wKnights),
+                 mirrorRanks(board.bBishops), mirrorRanks(board.wBishops), mirrorRanks(board.bRooks), mirrorRanks(board.wRooks),
+                 mirrorRanks(board.bQueens), mirrorRanks(board.wQueens), mirrorRanks(board.bKing), mirrorRanks(board.wKing), 0 };
+    }
+
+    /**
+     * Of all symmetric images of the position the one with the white king on files a-d, and without pawns also
+     * on ranks 1-4 and on or below the a1-h8 diagonal (the black king on or below it as well if the white king is
+     * on the diagonal).
+     */
+    inline Board canonical(Board board, bool pawns) {
+        int king = singleBitOf(board.wKing);
+        if(fileOf(king) > 3) board = transformed(board, mirrorFiles);
+        if(pawns) return board;
+        if(rankOf(singleBitOf(board.wKing)) > 3) board = transformed(board, mirrorRanks);
+        king = singleBitOf(board.wKing);
+        int enemy = singleBitOf(board.bKing);
+        if(rankOf(king) > fileOf(king) || (rankOf(king) == fileOf(king) && rankOf(enemy) > fileOf(enemy)))
+            board = transformed(board, transpose);
+        return board;
+    }
+
+    // the squares of the white king without pawns: a1-d1-d4, and their position in this list
+    constexpr std::array<int, 10> TRIANGLE{ 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+
+    constexpr std::array<int, 64> TRIANGLE_CODES = [] {
+        std::array<int, 64> codes{};
+        for(int& code: codes) code = -1;
+        for(int i = 0; i < 10; i++) codes[TRIANGLE[i]] = i;
+        return codes;
+    }();
+
+    // pawnless positions with both kings on the a1-h8 diagonal are stored in both orientations, see canonical()
+    inline bool onDiagonal(const Board& board, bool pawns) {
+        int king = singleBitOf(board.wKing), enemy = singleBitOf(board.bKing);
+        return !pawns && rankOf(king) == fileOf(king) && rankOf(enemy) == fileOf(enemy);
+    }
+
+    /**
+     * The index of a position of one material signature: the side to move, the square of the white king (one of
+     * 10 squares without pawns, of 32 with pawns, see canonical()), the square of the black king and the squares
+     * of the other pieces, 48 for pawns and 64 for all others. Identical pieces are stored by ascending square.
+     * Indices of placements that are impossible (two pieces on a square) or not canonical hold INVALID.
+     */
+    class Layout {
+        struct Slot {
+            Piece_t type;
+            bool white;
+        };
+
+        std::vector<Slot> pieces;
+        int kingSquares;
+
+        [[nodiscard]] int kingCode(int square) const {
+            return pawns ? rankOf(square) * 4 + fileOf(square) : TRIANGLE_CODES[square];
+        }
+
+        [[nodiscard]] int kingSquare(int code) const {
+            return pawns ? (code / 4) * 8 + code % 4 : TRIANGLE[code];
+        }
+
+        static int radix(const Slot& slot) {
+            return slot.type == Piece::Pawn ? 48 : 64;
+        }
+
+    public:
+        Material material;
+        bool pawns;
+        uint64_t size;
+        int pieceCount, pawnCount;
+
+        explicit Layout(const Material& material) : material{material}, pawns{material.hasPawns()} {
+            for(Piece_t type: material.white) pieces.push_back({ type, true });
+            for(Piece_t type: material.black) pieces.push_back({ type, false });
+            kingSquares = pawns ? 32 : 10;
+            size = 2ull * kingSquares * 64;
+            for(const Slot& slot: pieces) size *= radix(slot);
+            pieceCount = material.count();
+            pawnCount = static_cast<int>(std::count_if(pieces.begin(), pieces.end(), [](const Slot& s) { return s.type == Piece::Pawn; }));
+        }
+
+        // the board has to be canonical and of this material
+        [[nodiscard]] uint64_t index(const Board& board, bool whiteToMove) const {
+            uint64_t index = (whiteToMove ? kingSquares : 0) + kingCode(singleBitOf(board.wKing));
+            index = index * 64 + singleBitOf(board.bKing);
+            Board remaining = board;
+            for(const Slot& slot: pieces) {
+                BB& bb = remaining.*pieceField(slot.white, slot.type);
+                int square = firstBitOf(bb);
+                bb &= bb - 1;
+                index = index * radix(slot) + (slot.type == Piece::Pawn ? square - 8 : square);
+            }
+            return index;
+        }
+
+        // false if two pieces share a square
+        bool position(uint64_t index, Board& board, bool& whiteToMove) const {
+            std::array<int, MAX_PIECES> squares{};
+            for(int i = static_cast<int>(pieces.size()) - 1; i >= 0; i--) {
+                int r = radix(pieces[i]);
+                squares[i] = static_cast<int>(index % r) + (r == 48 ? 8 : 0);
+                index /= r;
+            }
+            int blackKing = static_cast<int>(index % 64);
+            index /= 64;
+            int whiteKing = kingSquare(static_cast<int>(index % kingSquares));
+            whiteToMove = index / kingSquares;
+
+            board = Board{};
+            board.wKing = newMask(whiteKing);
+            board.bKing = newMask(blackKing);
+            BB occ = board.wKing;
+            if(occ & board.bKing) return false;
+            occ |= board.bKing;
+            for(size_t i = 0; i < pieces.size(); i++) {
+                BB square = newMask(squares[i]);
+                if(occ & square) return false;
+                occ |= square;
+                board.*pieceField(pieces[i].white, pieces[i].type) |= square;
+            }
+            return true;
+        }
+    };
+
+    // whether the side that is not to move is in check, which makes the position impossible
+    inline bool isIllegal(const Board& board, bool whiteToMove) {
+        BB king = whiteToMove ? board.bKing : board.wKing;
+        BB movers = whiteToMove ? board.allPieces<true>() : board.allPieces<false>();
+        return SEE::attackersTo(board, singleBitOf(king), board.occ()) & movers;
+    }
+
+    /**
+     * The memory mapped tables of a directory. Tables are mapped at construction and whenever load() is called,
+     * probing itself only reads, so that any number of search threads can probe at the same time.
+     */
+    class Tablebases {
+        struct Table {
+            Layout layout;
+            MappedFile dtm, wdl;
+        };
+
+        std::string dir;
+        std::unordered_map<uint32_t, std::unique_ptr<Table>> tables;
+        int maxPieces{0};
+
+        // the table of the position and the index in it, nullptr if there is none
+        const Table* locate(const Board& board, bool whiteToMove, uint64_t& index) const {
+            uint32_t key = materialKey(board);
+            auto it = tables.find(key);
+            Board oriented = board;
+            if(it == tables.end()) {
+                it = tables.find(swappedKey(key));
+                if(it == tables.end()) return nullptr;
+                oriented = swapColors(board);
+                whiteToMove = !whiteToMove;
+            }
+            const Table& table = *it->second;
+            index = table.layout.index(canonical(oriented, table.layout.pawns), whiteToMove);
+            return &table;
+        }
+
+    public:
+        explicit Tablebases(std::string directory) : dir{std::move(directory)} {
+            std::error_code error;
+            for(const auto& file: std::filesystem::directory_iterator(dir, error))
+                if(file.path().extension() == ".dtm") load(file.path().stem().string());
+        }
+
+        // maps <name>.dtm and <name>.wdl, false if they do not exist or do not fit the material
+        bool load(const std::string& name) {
+            std::string base = (std::filesystem::path(dir) / name).string();
+            try {
+                Layout layout{Material::parse(name)};
+                MappedFile dtm{base + ".dtm"}, wdl{base + ".wdl"};
+                if(dtm.size() != 2 * layout.size || wdl.size() != (layout.size + 3) / 4) return false;
+                maxPieces = std::max(maxPieces, layout.pieceCount);
+                uint32_t key = layout.material.key();
+                tables[key] = std::make_unique<Table>(Table{ std::move(layout), std::move(dtm), std::move(wdl) });
+                return true;
+            } catch(std::exception& ex) {
+                return false;
+            }
+        }
+
+        [[nodiscard]] bool contains(const Material& material) const {
+            return tables.contains(material.key());
+        }
+
+        [[nodiscard]] int pieces() const {
+            return maxPieces;
+        }
+
+        // nothing for positions without a table, with castling rights or with a possible en passant capture
+        [[nodiscard]] std::optional<Result> probe(const Board& board, uint8_t state_code) const {
+            if((state_code & 0b1111) || bitCount(board.occ()) > maxPieces) return std::nullopt;
+            bool white = state_code & 0b10000;
+            if(white ? Zobrist::enPassantKey<true>(board) : Zobrist::enPassantKey<false>(board)) return std::nullopt;
+            uint64_t index;
+            const Table* table = locate(board, white, index);
+            if(!table) return std::nullopt;
+            uint16_t entry;
+            std::memcpy(&entry, table->dtm.data() + 2 * index, 2);
+            return decode(entry);
+        }
+
+        // the same from the smaller WDL file, which is more likely to stay in the caches
+        [[nodiscard]] std::optional<WDL> probeWDL(const Board& board, uint8_t state_code) const {
+            if((state_code & 0b1111) || bitCount(board.occ()) > maxPieces) return std::nullopt;
+            bool white = state_code & 0b10000;
+            if(white ? Zobrist::enPassantKey<true>(board) : Zobrist::enPassantKey<false>(board)) return std::nullopt;
+            uint64_t index;
+            const Table* table = locate(board, white, index);
+            if(!table) return std::nullopt;
+            return static_cast<WDL>((table->wdl.data()[index / 4] >> (2 * (index % 4))) & 3);
+        }
+    };
+
+    struct Stats {
+        std::string name;
+        uint64_t positions{0}, wins{0}, losses{0}, draws{0};
+        int longest{0};         // the longest DTM in plies
+        double seconds{0};
+    };
+
+    /**
+     * Retrograde analysis. The table is initialised with a pass over all positions: mates, stalemates and impossible
+     * positions are resolved, and for moves that capture or promote (which lead into smaller tables built before)
+     * the level at which they decide the position is noted. Then level n = 1, 2, ... resolves all positions with a
+     * DTM of n: the predecessors of the positions with DTM n-1 are found by un-moves (moves played backwards,
+     * without captures and promotions) and are checked with a regular move generation, which knows all successors
+     * with a DTM below n. Positions not resolved when no level finds anything new are draws.
+     * The passes over the table and the levels are split between threads.
+     */
+    class Generator {
+    public:
+        Generator(std::string directory, unsigned threads) : dir{std::move(directory)}, threads{std::max(1u, threads)}, tables{dir} {
+            std::filesystem::create_directories(dir);
+        }
+
+        // builds the table of the material and all tables it depends on, skipping tables that exist already
+        std::vector<Stats> build(std::string_view name) {
+            std::vector<Stats> built;
+            build(Material::parse(name), built);
+            return built;
+        }
+
+        [[nodiscard]] const Tablebases& tablebases() const {
+            return tables;
+        }
+
+    private:
+        std::string dir;
+        unsigned threads;
+        Tablebases tables;
+
+        // successors of a position, with those that leave the table (captures and promotions) counted separately
+        struct Summary {
+            int moves{0};
+            int fastestLoss{INT_MAX};   // of the opponent, among the resolved successors
+            int slowestWin{-1};
+            bool allWins{true};         // every successor is a resolved win of the opponent
+        };
+
+        // the move generation collector of the build, all state is per thread
+        struct Successors {
+            static thread_local const Layout* layout;
+            static thread_local const std::atomic<uint16_t>* entries;
+            static thread_local const Tablebases* tables;
+            static thread_local int limit;     // only entries with a DTM up to the limit are resolved
+            static thread_local Summary inside, outside;
+
+            template<State state, int depth>
+            static void main(Board& board) {
+                MoveGenerator<Successors>::template generate<state, 1>(board);
+            }
+
+            template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+            static void registerMove([[maybe_unused]] const Board& board, [[maybe_unused]] BB from, [[maybe_unused]] BB to) {}
+
+            template<State nextState, int depth>
+            static void next(Board& nextBoard) {
+                bool leaves = bitCount(nextBoard.occ()) != layout->pieceCount
+                              || bitCount(nextBoard.wPawns | nextBoard.bPawns) != layout->pawnCount;
+                Result result{ Draw, 0 };
+                if(leaves) {
+                    // captures and promotions never leave an en passant square behind
+                    std::optional<Result> probed = tables->probe(nextBoard, getStateCode<nextState>() & 0b10000);
+                    if(!probed) throw std::logic_error("missing tablebase " + Material::of(nextBoard).name());
+                    result = *probed;
+                } else {
+                    uint64_t index = layout->index(canonical(nextBoard, layout->pawns), nextState.whiteToMove);
+                    Result stored = decode(entries[index].load(std::memory_order_relaxed));
+                    if(stored.wdl != Invalid && stored.dtm <= limit) result = stored;
+                }
+
+                Summary& summary = leaves ? outside : inside;
+                summary.moves++;
+                if(result.wdl == Loss) summary.fastestLoss = std::min(summary.fastestLoss, result.dtm);
+                if(result.wdl == Win) summary.slowestWin = std::max(summary.slowestWin, result.dtm);
+                else summary.allWins = false;
+            }
+        };
+
+        struct Build {
+            Layout layout;
+            LargePages::Array<std::atomic<uint16_t>> entries;
+            LargePages::Array<uint16_t> pending;   // the level at which captures or promotions decide the position
+        };
+
+        void build(const Material& requested, std::vector<Stats>& built) {
+            Material material = requested.isCanonical() ? requested : requested.swapped();
+            if(tables.contains(material)) return;
+
+            // first every table a capture or a promotion leads to
+            for(int side = 0; side < 2; side++) {
+                const std::vector<Piece_t>& pieces = side == 0 ? material.white : material.black;
+                for(size_t i = 0; i < pieces.size(); i++) {
+                    Material smaller = material;
+                    std::vector<Piece_t>& own = side == 0 ? smaller.white : smaller.black;
+                    own.erase(own.begin() + static_cast<long>(i));
+                    build(smaller, built);
+                    if(pieces[i] != Piece::Pawn) continue;
+                    for(Piece_t promoted: { Piece::Queen, Piece::Rook, Piece::Bishop, Piece::Knight }) {
+                        Material promotion = smaller;
+                        std::vector<Piece_t>& side2 = side == 0 ? promotion.white : promotion.black;
+                        side2.push_back(promoted);
+                        std::sort(side2.begin(), side2.end());
+                        build(promotion, built);
+                    }
+                }
+            }
+            if(tables.contains(material)) return;
+            built.push_back(generate(material));
+        }
+
+        Stats generate(const Material& material) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            Layout layout{material};
+            Build b{ layout, LargePages::make<std::atomic<uint16_t>>(layout.size, true, threads),
+                     LargePages::make<uint16_t>(layout.size, true, threads) };
+
+            std::atomic<int> lastPending{0};
+            parallel(b, [&](uint64_t first, uint64_t last) {
+                int pendingMax = 0;
+                for(uint64_t index = first; index < last; index++) {
+                    Board board;
+                    bool white;
+                    if(!layout.position(index, board, white) || layout.index(canonical(board, layout.pawns), white) != index
+                       || isIllegal(board, white)) {
+                        b.entries[index].store(INVALID, std::memory_order_relaxed);
+                        continue;
+                    }
+                    successors(board, white, -1);
+                    const Summary& in = Successors::inside;
+                    const Summary& out = Successors::outside;
+                    if(in.moves + out.moves == 0) {
+                        bool check = SEE::attackersTo(board, singleBitOf(white ? board.wKing : board.bKing), board.occ())
+                                     & (white ? board.allPieces<false>() : board.allPieces<true>());
+                        if(check) b.entries[index].store(1, std::memory_order_relaxed);
+                    } else if(out.fastestLoss != INT_MAX) {
+                        b.pending[index] = static_cast<uint16_t>(out.fastestLoss + 1);
+                    } else if(out.moves > 0 && out.allWins) {
+                        b.pending[index] = static_cast<uint16_t>(out.slowestWin + 1);
+                    }
+                    pendingMax = std::max<int>(pendingMax, b.pending[index]);
+                }
+                int seen = lastPending.load();
+                while(pendingMax > seen && !lastPending.compare_exchange_weak(seen, pendingMax)) {}
+            });
+
+            for(int level = 1; ; level++) {
+                std::atomic<uint64_t> found{0};
+                parallel(b, [&](uint64_t first, uint64_t last) {
+                    uint64_t own = 0;
+                    for(uint64_t index = first; index < last; index++) {
+                        uint16_t entry = b.entries[index].load(std::memory_order_relaxed);
+                        if(entry == level) {
+                            Board board;
+                            bool white;
+                            layout.position(index, board, white);
+                            auto visit = [&](const Board& predecessor) {
+                                Board image = canonical(predecessor, layout.pawns);
+                                own += resolve(b, layout.index(image, !white), level);
+                                // the transposed twin is a predecessor as well
+                                if(onDiagonal(image, layout.pawns))
+                                    own += resolve(b, layout.index(transformed(image, transpose), !white), level);
+                            };
+                            if(white) unmoves<false>(board, visit);
+                            else unmoves<true>(board, visit);
+                        } else if(entry == DRAW && b.pending[index] == level) {
+                            own += resolve(b, index, level);
+                        }
+                    }
+                    found += own;
+                });
+                if(found == 0 && level >= lastPending) break;
+            }
+
+            Stats stats = write(b);
+            std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - t1;
+            stats.seconds = seconds.count();
+            if(!tables.load(material.name())) throw std::runtime_error("cannot load the tablebase " + material.name());
+            return stats;
+        }
+
+        // splits the index range of the table between the threads
+        template<typename Work>
+        void parallel(const Build& b, Work work) {
+            auto run = [&](unsigned id) {
+                Successors::layout = &b.layout;
+                Successors::entries = b.entries.get();
+                Successors::tables = &tables;
+                work(b.layout.size * id / threads, b.layout.size * (id + 1) / threads);
+            };
+            std::vector<std::thread> helpers;
+            for(unsigned id = 1; id < threads; id++) helpers.emplace_back(run, id);
+            run(0);
+            for(std::thread& helper: helpers) helper.join();
+        }
+
+        static void successors(const Board& board, bool white, int limit) {
+            Successors::limit = limit;
+            Successors::inside = {};
+            Successors::outside = {};
+            Board copy = board;
+            Utils::run<Successors, 1>(white ? 0b10000 : 0, copy);
+        }
+
+        // resolves the position if all successors needed are known at this level, 1 if it did
+        int resolve(Build& b, uint64_t index, int level) {
+            if(b.entries[index].load(std::memory_order_relaxed) != DRAW) return 0;
+            Board board;
+            bool white;
+            b.layout.position(index, board, white);
+            successors(board, white, level - 1);
+            const Summary& in = Successors::inside;
+            const Summary& out = Successors::outside;
+
+            int dtm;
+            if(std::min(in.fastestLoss, out.fastestLoss) != INT_MAX) dtm = std::min(in.fastestLoss, out.fastestLoss) + 1;
+            else if(in.allWins && out.allWins && in.moves + out.moves > 0) dtm = std::max(in.slowestWin, out.slowestWin) + 1;
+            else return 0;
+
+            uint16_t expected = DRAW;
+            return b.entries[index].compare_exchange_strong(expected, static_cast<uint16_t>(dtm + 1), std::memory_order_relaxed);
+        }
+
+        /**
+         * Calls visit with every position from which the side that just moved ('mover') could have reached this
+         * one without capturing or promoting: its pieces step back to empty squares along the step tables.
+         */
+        template<bool mover, typename Visit>
+        static void unmoves(const Board& board, Visit visit) {
+            const BB empty = ~board.occ();
+            auto back = [&](BB Board::* field, int square, BB sources) {
+                Bitloop(sources) {
+                    Board predecessor = board;
+                    predecessor.*field ^= newMask(square) | newMask(firstBitOf(sources));
+                    visit(predecessor);
+                }
+            };
+
+            for(BB bb = board.knights<mover>(); bb; bb &= bb - 1)
+                back(pieceField(mover, Piece::Knight), firstBitOf(bb), PieceSteps::KNIGHT_MOVES[firstBitOf(bb)] & empty);
+            for(BB bb = board.bishops<mover>(); bb; bb &= bb - 1)
+                back(pieceField(mover, Piece::Bishop), firstBitOf(bb), PieceSteps::slideMask<true>(board.occ(), firstBitOf(bb)) & empty);
+            for(BB bb = board.rooks<mover>(); bb; bb &= bb - 1)
+                back(pieceField(mover, Piece::Rook), firstBitOf(bb), PieceSteps::slideMask<false>(board.occ(), firstBitOf(bb)) & empty);
+            for(BB bb = board.queens<mover>(); bb; bb &= bb - 1)
+                back(pieceField(mover, Piece::Queen), firstBitOf(bb), (PieceSteps::slideMask<true>(board.occ(), firstBitOf(bb))
+                                                                      | PieceSteps::slideMask<false>(board.occ(), firstBitOf(bb))) & empty);
+            back(pieceField(mover, Piece::King), board.kingSquare<mover>(), PieceSteps::KING_MOVES[board.kingSquare<mover>()] & empty);
+
+            // pawns cannot come from the first rank, double pushes start on the pawns' starting rank
+            for(BB bb = board.pawns<mover>(); bb; bb &= bb - 1) {
+                BB pawn = isolateLowestBit(bb);
+                BB single = backward<mover>(pawn) & empty & ~(mover ? rank1 : rank8);
+                BB twice = backward2<mover>(pawn) & empty & firstRank<mover>();
+                back(pieceField(mover, Piece::Pawn), firstBitOf(bb), single | (single ? twice : 0));
+            }
+        }
+
+        // the files are written in chunks (of a multiple of 4 positions), the stats are counted on the way
+        Stats write(const Build& b) {
+            constexpr uint64_t CHUNK = 1 << 20;
+            Stats stats{ b.layout.material.name() };
+            std::string base = (std::filesystem::path(dir) / stats.name).string();
+            std::ofstream dtmFile{base + ".dtm", std::ios::binary}, wdlFile{base + ".wdl", std::ios::binary};
+            std::vector<uint16_t> dtm(CHUNK);
+            std::vector<uint8_t> wdl(CHUNK / 4);
+            for(uint64_t first = 0; first < b.layout.size; first += CHUNK) {
+                uint64_t count = std::min(CHUNK, b.layout.size - first);
+                std::fill(wdl.begin(), wdl.end(), 0);
+                for(uint64_t i = 0; i < count; i++) {
+                    uint16_t entry = b.entries[first + i].load(std::memory_order_relaxed);
+                    Result result = decode(entry);
+                    dtm[i] = entry;
+                    wdl[i / 4] |= result.wdl << (2 * (i % 4));
+                    if(result.wdl == Invalid) continue;
+                    stats.positions++;
+                    stats.wins += result.wdl == Win;
+                    stats.losses += result.wdl == Loss;
+                    stats.draws += result.wdl == Draw;
+                    stats.longest = std::max(stats.longest, result.dtm);
+                }
+                dtmFile.write(reinterpret_cast<const char*>(dtm.data()), static_cast<std::streamsize>(2 * count));
+                wdlFile.write(reinterpret_cast<const char*>(wdl.data()), static_cast<std::streamsize>((count + 3) / 4));
+            }
+            if(!dtmFile || !wdlFile) throw std::runtime_error("cannot write " + base);
+            return stats;
+        }
+    };
+
+    thread_local const Layout* Generator::Successors::layout{nullptr};
+    thread_local const std::atomic<uint16_t>* Generator::Successors::entries{nullptr};
+    thread_local const Tablebases* Generator::Successors::tables{nullptr};
+    thread_local int Generator::Successors::limit{0};
+    thread_local Generator::Summary Generator::Successors::inside{};
+    thread_local Generator::Summary Generator::Successors::outside{};
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_TABLEBASE_H
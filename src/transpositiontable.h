@@ -0,0 +1,132 @@
+//
+// Created by Robin on 19.10.2026.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "chess.h"
+#include "largepages.h"
+
+#ifndef DORY_TRANSPOSITIONTABLE_H
+#define DORY_TRANSPOSITIONTABLE_H
+
+DORY_NAMESPACE_BEGIN
+
+/**
+ * Hash table for search results that can be shared by any number of threads without locks.
+ *
+ * Every entry consists of two 64 bit words, the packed data and the key XOR the data. A probe only accepts an entry
+ * if both words belong together, so an entry that is torn by two threads writing at the same time reads as a miss
+ * instead of handing out the data of another position.
+ * Replacement is depth-preferred: an entry of the current search is only overwritten by a result of at least the
+ * same depth, entries of older searches are always replaced.
+ * The entries live on large pages if possible (see LargePages), a probe then rarely misses the TLB.
+ */
+class TranspositionTable {
+public:
+    enum Bound : uint8_t { None, Upper, Lower, Exact };
+
+    struct Data {
+        int score{0};
+        PackedMove move{0};
+        uint8_t depth{0};
+        Bound bound{None};
+    };
+
+    explicit TranspositionTable(size_t megabytes = 16, bool largePages = true) : largePages{largePages} {
+        resize(megabytes);
+    }
+
+    // the number of entries is rounded down to a power of two, the table is cleared by 'threads' threads
+    void resize(size_t megabytes, unsigned threads = 1) {
+        size_t count = 1;
+        while(2 * count * sizeof(Entry) <= megabytes * LargePages::MB) count *= 2;
+        entries.reset();
+        entries = LargePages::make<Entry>(count, largePages, threads);
+        mask = count - 1;
+        generation = 0;
+    }
+
+    void clear(unsigned threads = 1) {
+        auto clearPart = [this, threads](unsigned id) {
+            size_t first = size() * id / threads, last = size() * (id + 1) / threads;
+            for(size_t i = first; i < last; i++) {
+                entries[i].check.store(0, std::memory_order_relaxed);
+                entries[i].data.store(0, std::memory_order_relaxed);
+            }
+        };
+        std::vector<std::thread> helpers;
+        for(unsigned id = 1; id < threads; id++) helpers.emplace_back(clearPart, id);
+        clearPart(0);
+        for(std::thread& helper: helpers) helper.join();
+    }
+
+    // called before every new search, so that the results of older searches get replaced first
+    void newSearch() {
+        generation = (generation + 1) & GENERATION_MASK;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return mask + 1;
+    }
+
+    // the kind of pages the entries ended up on
+    [[nodiscard]] LargePages::Pages pages() const {
+        return entries.get_deleter().pages;
+    }
+
+    bool probe(uint64_t key, Data& out) const {
+        const Entry& entry = entries[key & mask];
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if((entry.check.load(std::memory_order_relaxed) ^ data) != key || data == 0) return false;
+        out = unpack(data);
+        return true;
+    }
+
+    void store(uint64_t key, const Data& result) {
+        Entry& entry = entries[key & mask];
+        uint64_t old = entry.data.load(std::memory_order_relaxed);
+        bool sameKey = (entry.check.load(std::memory_order_relaxed) ^ old) == key;
+        if(!sameKey && old != 0 && generationOf(old) == generation && unpack(old).depth > result.depth) return;
+
+        Data keep = result;
+        // a result without a best move (e.g. a fail low) keeps the move of the earlier search of the position
+        if(sameKey && keep.move == 0) keep.move = unpack(old).move;
+        uint64_t data = pack(keep);
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check{0}, data{0};
+    };
+
+    static constexpr uint8_t GENERATION_MASK = 0x3f;
+
+    LargePages::Array<Entry> entries;
+    size_t mask{0};
+    bool largePages;
+    uint8_t generation{0};
+
+    // score in bits 0-31, move in 32-47, depth in 48-55, bound in 56-57 and the generation in 58-63
+    [[nodiscard]] uint64_t pack(const Data& d) const {
+        return static_cast<uint32_t>(d.score) | static_cast<uint64_t>(d.move) << 32 | static_cast<uint64_t>(d.depth) << 48
+               | static_cast<uint64_t>(d.bound) << 56 | static_cast<uint64_t>(generation) << 58;
+    }
+
+    static Data unpack(uint64_t data) {
+        return { static_cast<int32_t>(static_cast<uint32_t>(data)), static_cast<PackedMove>(data >> 32),
+                 static_cast<uint8_t>(data >> 48), static_cast<Bound>((data >> 56) & 0b11) };
+    }
+
+    static uint8_t generationOf(uint64_t data) {
+        return static_cast<uint8_t>(data >> 58);
+    }
+};
+
+DORY_NAMESPACE_END
+
+#endif //DORY_TRANSPOSITIONTABLE_H
@@ -11,6 +11,8 @@
 #ifndef DORY_UTILS_H
 #define DORY_UTILS_H
 
+DORY_NAMESPACE_BEGIN
+
 namespace Utils {
 
     using ByteBoard = std::array<uint8_t, 64>;
@@ -169,6 +171,29 @@ namespace Utils {
         return bss.str();
     }
 
+    /**
+     * Writes the move in UCI notation (e.g. "e2e4", "e7e8q") into buf, which needs to hold at least 6 characters.
+     * @return the number of characters written, excluding the terminating null byte
+     */
+    int uciMove(PackedMove move, char* buf) {
+        int from = packedFrom(move), to = packedTo(move);
+        buf[0] = filename(fileOf(from));
+        buf[1] = static_cast<char>('1' + rankOf(from));
+        buf[2] = filename(fileOf(to));
+        buf[3] = static_cast<char>('1' + rankOf(to));
+
+        int length = 4;
+        switch (packedFlags(move)) {
+            case MoveFlag::PromoteQueen:  buf[length++] = 'q'; break;
+            case MoveFlag::PromoteRook:   buf[length++] = 'r'; break;
+            case MoveFlag::PromoteBishop: buf[length++] = 'b'; break;
+            case MoveFlag::PromoteKnight: buf[length++] = 'n'; break;
+            default: break;
+        }
+        buf[length] = '\0';
+        return length;
+    }
+
     template<typename Collector, State state, int depth>
     void time_movegen(Board& board) {
         auto t1 = std::chrono::high_resolution_clock::now();
@@ -210,4 +235,6 @@ namespace Utils {
     };
 }
 
+DORY_NAMESPACE_END
+
 #endif //DORY_UTILS_H
@@ -0,0 +1,179 @@
+//
+// Created by Robin on 18.10.2026.
+//
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "board.h"
+
+#ifndef DORY_ZOBRIST_H
+#define DORY_ZOBRIST_H
+
+DORY_NAMESPACE_BEGIN
+
+namespace Zobrist {
+
+    struct Keys {
+        std::array<std::array<uint64_t, 64>, 12> pieces{};
+        std::array<uint64_t, 16> castling{};
+        std::array<uint64_t, 8> enPassantFile{};
+        uint64_t whiteToMove{0};
+    };
+
+    // splitmix64, so the keys are fixed at compile time
+    constexpr uint64_t nextRandom(uint64_t& seed) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    constexpr Keys generateKeys() {
+        Keys keys{};
+        uint64_t seed = 0x446f7279;
+        for(auto& squares: keys.pieces)
+            for(uint64_t& key: squares) key = nextRandom(seed);
+        // the castling keys are combined from the four individual rights
+        std::array<uint64_t, 4> rights{};
+        for(uint64_t& key: rights) key = nextRandom(seed);
+        for(int code = 0; code < 16; code++)
+            for(int right = 0; right < 4; right++)
+                if(code & (1 << right)) keys.castling[code] ^= rights[right];
+        for(uint64_t& key: keys.enPassantFile) key = nextRandom(seed);
+        keys.whiteToMove = nextRandom(seed);
+        return keys;
+    }
+
+    constexpr Keys KEYS = generateKeys();
+
+    template<bool white>
+    constexpr int pieceIndex(Piece_t piece) {
+        return 2 * (piece - 1) + (white ? 0 : 1);
+    }
+
+    template<bool white, Piece_t piece>
+    constexpr uint64_t pieceKey(BB square) {
+        return KEYS.pieces[pieceIndex<white>(piece)][singleBitOf(square)];
+    }
+
+    /**
+     * The en passant field only changes the key if the side to move can actually capture en passant,
+     * otherwise positions that differ only in the e.p. field would not count as repetitions.
+     */
+    template<bool whiteToMove>
+    constexpr uint64_t enPassantKey(const Board& board) {
+        BB pawns = board.pawns<whiteToMove>();
+        BB attacks = pawnAtkLeft<whiteToMove>(pawns & pawnCanGoLeft<whiteToMove>()) | pawnAtkRight<whiteToMove>(pawns & pawnCanGoRight<whiteToMove>());
+        if(attacks & board.enPassantField) return KEYS.enPassantFile[fileOf(singleBitOf(board.enPassantField))];
+        return 0;
+    }
+
+    /**
+     * Computes the key of a position from scratch.
+     */
+    uint64_t hash(const Board& board, uint8_t state_code) {
+        uint64_t key = 0;
+        auto addPieces = [&key](BB pieces, int index) {
+            Bitloop(pieces) key ^= KEYS.pieces[index][firstBitOf(pieces)];
+        };
+        addPieces(board.wPawns, pieceIndex<true>(Piece::Pawn));     addPieces(board.bPawns, pieceIndex<false>(Piece::Pawn));
+        addPieces(board.wKnights, pieceIndex<true>(Piece::Knight)); addPieces(board.bKnights, pieceIndex<false>(Piece::Knight));
+        addPieces(board.wBishops, pieceIndex<true>(Piece::Bishop)); addPieces(board.bBishops, pieceIndex<false>(Piece::Bishop));
+        addPieces(board.wRooks, pieceIndex<true>(Piece::Rook));     addPieces(board.bRooks, pieceIndex<false>(Piece::Rook));
+        addPieces(board.wQueens, pieceIndex<true>(Piece::Queen));   addPieces(board.bQueens, pieceIndex<false>(Piece::Queen));
+        addPieces(board.wKing, pieceIndex<true>(Piece::King));      addPieces(board.bKing, pieceIndex<false>(Piece::King));
+
+        key ^= KEYS.castling[state_code & 0b1111];
+        if(state_code & 0b10000) key ^= KEYS.whiteToMove ^ enPassantKey<true>(board);
+        else key ^= enPassantKey<false>(board);
+        return key;
+    }
+
+    /**
+     * Updates the key of 'board' to the key of 'next' = board.getNextBoard<state, piece, flags>(from, to).
+     */
+    template<State state, Piece_t piece, Flag_t flags>
+    uint64_t nextKey(uint64_t key, const Board& board, const Board& next, BB from, BB to) {
+        constexpr bool white = state.whiteToMove;
+        constexpr State nextState = getNextState<state, flags>();
+
+        key ^= KEYS.whiteToMove;
+        key ^= KEYS.castling[getStateCode<state>() & 0b1111] ^ KEYS.castling[getStateCode<nextState>() & 0b1111];
+        key ^= enPassantKey<white>(board) ^ enPassantKey<!white>(next);
+
+        if constexpr (flags == MoveFlag::ShortCastling || flags == MoveFlag::LongCastling) {
+            BB rookMove = flags == MoveFlag::ShortCastling ? castleShortRookMove<white>() : castleLongRookMove<white>();
+            key ^= pieceKey<white, Piece::King>(from) ^ pieceKey<white, Piece::King>(to);
+            key ^= pieceKey<white, Piece::Rook>(isolateLowestBit(rookMove)) ^ pieceKey<white, Piece::Rook>(rookMove & (rookMove - 1));
+            return key;
+        }
+
+        if constexpr (flags == MoveFlag::EnPassantCapture) {
+            key ^= pieceKey<!white, Piece::Pawn>(backward<white>(to));
+        } else {
+            Piece_t captured = board.pieceAt<!white>(to);
+            if(captured) key ^= KEYS.pieces[pieceIndex<!white>(captured)][singleBitOf(to)];
+        }
+
+        key ^= pieceKey<white, piece>(from);
+        if constexpr (isPromotion(flags)) key ^= pieceKey<white, promotedPiece<flags>()>(to);
+        else key ^= pieceKey<white, piece>(to);
+        return key;
+    }
+
+    /**
+     * Keys of all positions of a game (or search path) so far.
+     * A position can only repeat since the last capture or pawn move, so the lookups only
+     * scan back as many plies as the halfmove clock of the current position allows.
+     */
+    class History {
+        std::vector<uint64_t> keys;
+
+    public:
+        explicit History(size_t capacity = 1024) {
+            keys.reserve(capacity);
+        }
+
+        void push(uint64_t key) {
+            keys.push_back(key);
+        }
+
+        void pop() {
+            keys.pop_back();
+        }
+
+        void clear() {
+            keys.clear();
+        }
+
+        [[nodiscard]] size_t size() const {
+            return keys.size();
+        }
+
+        // number of earlier occurrences of the current (= last pushed) position
+        [[nodiscard]] int repetitions(unsigned halfmoveClock) const {
+            if(keys.empty()) return 0;
+            size_t last = keys.size() - 1;
+            size_t limit = std::min<size_t>(halfmoveClock, last);
+            uint64_t key = keys[last];
+            int count = 0;
+            // the same side has to be to move, and at least two moves per side are needed to return
+            for(size_t back = 4; back <= limit; back += 2)
+                if(keys[last - back] == key) count++;
+            return count;
+        }
+
+        [[nodiscard]] bool isRepetition(unsigned halfmoveClock) const {
+            return repetitions(halfmoveClock) >= 1;
+        }
+
+        [[nodiscard]] bool isThreefoldRepetition(unsigned halfmoveClock) const {
+            return repetitions(halfmoveClock) >= 2;
+        }
+    };
+}
+
+DORY_NAMESPACE_END
+
+#endif //DORY_ZOBRIST_H
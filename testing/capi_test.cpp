@@ -0,0 +1,44 @@
+//
+// Created by Robin on 18.10.2026.
+//
+
+#include <gtest/gtest.h>
+
+#include "../src/dory.h"
+
+TEST(CApi, LegalMovesAndPerft) {
+    dory_position pos;
+    ASSERT_EQ(dory_position_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -", &pos), 0);
+
+    dory_move moves[DORY_MAX_MOVES];
+    ASSERT_EQ(dory_legal_moves(&pos, moves, DORY_MAX_MOVES), 48);
+    ASSERT_EQ(dory_legal_moves(&pos, moves, 10), 48);
+    ASSERT_EQ(dory_perft(&pos, 3), 97'862);
+    ASSERT_EQ(dory_perft(&pos, 0), 0);
+}
+
+TEST(CApi, ApplyMove) {
+    dory_position pos, next;
+    ASSERT_EQ(dory_position_from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", &pos), 0);
+
+    // e2e4
+    ASSERT_EQ(dory_apply_move(&pos, {12, 28, DORY_PAWN, DORY_FLAG_DOUBLE_PUSH}, &next), 0);
+    char fen[128];
+    ASSERT_GT(dory_position_to_fen(&next, fen, sizeof(fen)), 0);
+    ASSERT_STREQ(fen, "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+
+    // e2e5 is not legal
+    ASSERT_EQ(dory_apply_move(&pos, {12, 36, DORY_PAWN, 0}, &next), -1);
+}
+
+TEST(CApi, Batch) {
+    dory_position positions[2];
+    ASSERT_EQ(dory_position_from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", &positions[0]), 0);
+    ASSERT_EQ(dory_position_from_fen("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -", &positions[1]), 0);
+
+    dory_move moves[2 * DORY_MAX_MOVES];
+    size_t counts[2];
+    dory_legal_moves_batch(positions, 2, moves, DORY_MAX_MOVES, counts);
+    ASSERT_EQ(counts[0], 20);
+    ASSERT_EQ(counts[1], 14);
+}
@@ -3,9 +3,21 @@
 //
 
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
 
 #include "../src/movecollectors.h"
 #include "../src/fenreader.h"
+#include "../src/zobrist.h"
+#include "../src/moveiterator.h"
+#include "../src/gamestate.h"
+#include "../src/search.h"
+#include "../src/see.h"
+#include "../src/transpositiontable.h"
+#include "../src/largepages.h"
+#include "../src/pgn.h"
+#include "../src/polyglot.h"
+#include "../src/tablebase.h"
 
 using uLong = unsigned long long;
 using Collector = MoveCollectors::PerftCollector;
@@ -163,4 +175,767 @@ TEST(Scenarios, StalemateAndCheckmate) {
 
 TEST(Scenarios, StalemateAndCheckmate2) {
     checkSingleDepth<4>("8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 23527);
-}
\ No newline at end of file
+}
+TEST(FEN, RoundTrip) {
+    PieceSteps::load();
+    for(std::string_view fen: {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    }) {
+        ExtendedBoard eboard = Utils::parseFEN(fen);
+        ASSERT_EQ(Utils::toFEN(eboard.board, eboard.state_code), fen);
+    }
+}
+
+TEST(FEN, SuccessorRoundTrip) {
+    PieceSteps::load();
+    ExtendedBoard root = Utils::parseFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+    MoveCollectors::SuccessorBoards::getLegalMoves(root);
+    ASSERT_EQ(MoveCollectors::SuccessorBoards::positions.size(), 48);
+
+    char buf[Utils::MAX_FEN_LENGTH];
+    for(const ExtendedBoard& eboard: MoveCollectors::SuccessorBoards::positions) {
+        size_t length = Utils::toFEN(eboard.board, eboard.state_code, eboard.board.halfmoveClock, eboard.board.fullmoveNumber, buf);
+        ASSERT_EQ(Utils::parseFEN({buf, length}), eboard);
+    }
+}
+
+TEST(FEN, Invalid) {
+    ASSERT_THROW(Utils::parseFEN("8/8/8/8/8/8/8/8 w"), std::invalid_argument);
+    ASSERT_THROW(Utils::parseFEN("8/8/8/8/8/8/8/8 x - -"), std::invalid_argument);
+    ASSERT_THROW(Utils::parseFEN("8/8/8/8/8/8/8/8 w - e4"), std::invalid_argument);
+}
+
+struct DivideRunner {
+    template<State state, int depth>
+    static void main(Board& board) {
+        MoveCollectors::Divide::generateGameTree<state, depth>(board);
+    }
+};
+
+TEST(Divide, SubtreesSumToPerft) {
+    PieceSteps::load();
+    Utils::loadFEN<DivideRunner, 3>("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+    ASSERT_EQ(MoveCollectors::Divide::curr, 48);
+    ASSERT_EQ(MoveCollectors::Divide::totalNodes, 97'862);
+}
+
+TEST(Divide, UciPromotions) {
+    PieceSteps::load();
+    Utils::loadFEN<DivideRunner, 2>("8/P1k5/K7/8/8/8/8/8 w - - 0 1");
+
+    std::vector<std::string> names;
+    char name[6];
+    for(unsigned long long i{0}; i < MoveCollectors::Divide::curr; i++) {
+        Utils::uciMove(MoveCollectors::Divide::moves[i], name);
+        names.emplace_back(name);
+    }
+    for(auto promotion: {"a7a8q", "a7a8r", "a7a8b", "a7a8n"})
+        ASSERT_NE(std::find(names.begin(), names.end(), promotion), names.end());
+}
+
+template<typename C>
+struct TotalNodesRunner {
+    template<State state, int depth>
+    static void main(Board& board) {
+        C::template generateGameTree<state, depth>(board);
+    }
+};
+
+template<int depth>
+void checkMakeUnmake(std::string_view fen) {
+    using CopyMake = MoveCollectors::LimitedDFS<false, false>;
+    using MakeUnmake = MoveCollectors::LimitedDFS<false, false, MovePolicy::MakeUnmake>;
+    PieceSteps::load();
+
+    ExtendedBoard eboard = Utils::parseFEN(fen);
+    Board board = eboard.board;
+    Utils::run<TotalNodesRunner<CopyMake>, depth>(eboard.state_code, board);
+    Utils::run<TotalNodesRunner<MakeUnmake>, depth>(eboard.state_code, board);
+    ASSERT_EQ(MakeUnmake::totalNodes, CopyMake::totalNodes);
+    ASSERT_EQ(board, eboard.board);
+}
+
+TEST(MakeUnmake, MatchesCopyMake) {
+    checkMakeUnmake<4>("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+    checkMakeUnmake<5>("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -");
+    checkMakeUnmake<4>("r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1");
+    checkMakeUnmake<4>("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8");
+    checkMakeUnmake<5>("8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1");
+}
+
+TEST(MoveCounters, HalfmoveAndFullmove) {
+    Board board = STARTBOARD;
+    auto game = Utils::MoveSimulator<STARTSTATE>(board)
+        .move<Piece::Knight>("g1", "f3")
+        .move<Piece::Knight>("g8", "f6");
+    ASSERT_EQ(game.board.halfmoveClock, 2);
+    ASSERT_EQ(game.board.fullmoveNumber, 2);
+
+    auto pawnMove = game.move<Piece::Pawn, MoveFlag::PawnDoublePush>("e2", "e4");
+    ASSERT_EQ(pawnMove.board.halfmoveClock, 0);
+    ASSERT_EQ(pawnMove.board.fullmoveNumber, 2);
+
+    auto capture = pawnMove.move<Piece::Knight>("f6", "e4");
+    ASSERT_EQ(capture.board.halfmoveClock, 0);
+    ASSERT_EQ(capture.board.fullmoveNumber, 3);
+
+    ExtendedBoard eboard = Utils::parseFEN("8/8/8/8/8/8/8/K6k w - - 99 80");
+    ASSERT_FALSE(eboard.board.isFiftyMoveDraw());
+    auto kingMove = Utils::MoveSimulator<Utils::toState(0b10000)>(eboard.board).move<Piece::King>("a1", "a2");
+    ASSERT_TRUE(kingMove.board.isFiftyMoveDraw());
+}
+
+struct ZobristCheck {
+    static uint64_t expected;
+    static unsigned long long checked, mismatches;
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        MoveGenerator<ZobristCheck>::template generate<state, depth>(board);
+    }
+
+    template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+    static void registerMove(Board &board, BB from, BB to) {
+        Board next = board.getNextBoard<state, piece, flags>(from, to);
+        expected = Zobrist::nextKey<state, piece, flags>(Zobrist::hash(board, getStateCode<state>()), board, next, from, to);
+    }
+
+    template<State nextState, int depth>
+    static void next(Board& nextBoard) {
+        checked++;
+        if(Zobrist::hash(nextBoard, getStateCode<nextState>()) != expected) mismatches++;
+        if constexpr (depth > 1) MoveGenerator<ZobristCheck>::template generate<nextState, depth-1>(nextBoard);
+    }
+};
+uint64_t ZobristCheck::expected{0};
+unsigned long long ZobristCheck::checked{0}, ZobristCheck::mismatches{0};
+
+TEST(Zobrist, IncrementalMatchesFullHash) {
+    PieceSteps::load();
+    for(std::string_view fen: {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+        "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+    }) {
+        ZobristCheck::checked = 0;
+        ZobristCheck::mismatches = 0;
+        Utils::loadFEN<ZobristCheck, 3>(fen);
+        ASSERT_GT(ZobristCheck::checked, 0);
+        ASSERT_EQ(ZobristCheck::mismatches, 0);
+    }
+}
+
+template<State state>
+uint64_t key(const Utils::MoveSimulator<state>& position) {
+    return Zobrist::hash(position.board, getStateCode<state>());
+}
+
+TEST(Zobrist, ThreefoldRepetition) {
+    Board board = STARTBOARD;
+    Zobrist::History history;
+
+    auto p0 = Utils::MoveSimulator<STARTSTATE>(board);
+    auto p1 = p0.move<Piece::Knight>("g1", "f3");
+    auto p2 = p1.move<Piece::Knight>("g8", "f6");
+    auto p3 = p2.move<Piece::Knight>("f3", "g1");
+    auto p4 = p3.move<Piece::Knight>("f6", "g8");
+    auto p5 = p4.move<Piece::Knight>("g1", "f3");
+    auto p6 = p5.move<Piece::Knight>("g8", "f6");
+    auto p7 = p6.move<Piece::Knight>("f3", "g1");
+    auto p8 = p7.move<Piece::Knight>("f6", "g8");
+
+    for(uint64_t k: {key(p0), key(p1), key(p2), key(p3)}) history.push(k);
+    ASSERT_FALSE(history.isRepetition(p3.board.halfmoveClock));
+    history.push(key(p4));
+    ASSERT_TRUE(history.isRepetition(p4.board.halfmoveClock));
+    ASSERT_FALSE(history.isThreefoldRepetition(p4.board.halfmoveClock));
+    for(uint64_t k: {key(p5), key(p6), key(p7), key(p8)}) history.push(k);
+    ASSERT_TRUE(history.isThreefoldRepetition(p8.board.halfmoveClock));
+
+    // a pawn move resets the clock, so older positions are no longer considered
+    ASSERT_FALSE(history.isRepetition(0));
+}
+
+TEST(SliderAttacks, TablesMatchRayWalk) {
+    PieceSteps::load();
+    uint64_t seed = 0x9e3779b97f4a7c15;
+    for(int i = 0; i < 2000; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        BB occ = seed & (seed >> 3);
+        for(int sq = 0; sq < 64; sq++) {
+            ASSERT_EQ(PieceSteps::slideMask<true>(occ, sq), PieceSteps::slideMaskByRays<true>(occ, sq));
+            ASSERT_EQ(PieceSteps::slideMask<false>(occ, sq), PieceSteps::slideMaskByRays<false>(occ, sq));
+        }
+    }
+}
+
+TEST(SliderAttacks, KoggeStoneMatchesPerPiece) {
+    PieceSteps::load();
+    uint64_t seed = 0x2545f4914f6cdd1d;
+    auto random = [&seed]() {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        return seed;
+    };
+    for(int i = 0; i < 10000; i++) {
+        BB occ = random() & random();
+        BB diagonal = occ & random() & random(), straight = occ & random() & random();
+        BB expected = SliderAttacks::PerPiece::attacks(diagonal, straight, occ);
+        ASSERT_EQ(SliderAttacks::KoggeStone::attacks(diagonal, straight, occ), expected);
+        ASSERT_EQ(SliderAttacks::Vector::attacks(diagonal, straight, occ), expected);
+#if defined(__AVX2__)
+        ASSERT_EQ(SliderAttacks::KoggeStoneAVX2::attacks(diagonal, straight, occ), expected);
+#endif
+    }
+}
+
+TEST(PieceSteps, Between) {
+    PieceSteps::load();
+    // a1 - h8
+    ASSERT_EQ(PieceSteps::BETWEEN[0][63], 0x0040201008040200ull);
+    // e1 - e8
+    ASSERT_EQ(PieceSteps::BETWEEN[4][60], 0x0010101010101000ull);
+    // neighbours and unaligned squares
+    ASSERT_EQ(PieceSteps::BETWEEN[27][28], 0ull);
+    ASSERT_EQ(PieceSteps::BETWEEN[1][18], 0ull);
+    for(int a = 0; a < 64; a++)
+        for(int b = 0; b < 64; b++)
+            ASSERT_EQ(PieceSteps::BETWEEN[a][b], PieceSteps::BETWEEN[b][a]);
+}
+
+// records the moves of a position through the callback interface and through MoveIterator
+struct MoveRecorder {
+    static inline std::vector<std::pair<PackedMove, Piece_t>> generated{}, iterated{};
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        generated.clear();
+        iterated.clear();
+        MoveGenerator<MoveRecorder>::template generate<state, 1>(board);
+        MoveIterator<state> it{board};
+        Move move;
+        while(it.next(move)) iterated.emplace_back(packMove(move.from, move.to, move.flags), move.piece);
+    }
+
+    template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+    static void registerMove([[maybe_unused]] const Board& board, BB from, BB to) {
+        generated.emplace_back(packMove(from, to, flags), piece);
+    }
+
+    template<State nextState, int depth>
+    static void next([[maybe_unused]] Board& nextBoard) {}
+};
+
+TEST(MoveIterator, MatchesGenerator) {
+    PieceSteps::load();
+    for(std::string_view fen: {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+        ExtendedBoard root = Utils::parseFEN(fen);
+        MoveCollectors::SuccessorBoards::getLegalMoves(root);
+        std::vector<ExtendedBoard> positions{root};
+        for(const ExtendedBoard& successor: MoveCollectors::SuccessorBoards::positions) positions.push_back(successor);
+
+        for(ExtendedBoard& position: positions) {
+            Utils::run<MoveRecorder, 1>(position.state_code, position.board);
+            ASSERT_EQ(MoveRecorder::iterated, MoveRecorder::generated) << Utils::toFEN(position.board, position.state_code);
+        }
+    }
+}
+
+TEST(GameState, CheckmateAndStalemate) {
+    PieceSteps::load();
+    // fool's mate
+    ASSERT_TRUE(GameState::isCheckmate(Utils::parseFEN("rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3")));
+    // scholar's mate
+    ASSERT_TRUE(GameState::isCheckmate(Utils::parseFEN("r1bqkb1r/pppp1Qpp/2n2n2/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 0 4")));
+    ASSERT_TRUE(GameState::isStalemate(Utils::parseFEN("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1")));
+    // stalemate with a blocked pawn
+    ASSERT_TRUE(GameState::isStalemate(Utils::parseFEN("k7/p7/P7/8/8/8/1R6/KR6 b - - 0 1")));
+    // check by a pawn that can be captured en passant
+    ASSERT_TRUE(GameState::hasLegalMove(Utils::parseFEN("8/8/8/2k5/3Pp3/8/8/K3Q3 b - d3 0 1")));
+    ASSERT_FALSE(GameState::isCheckmate(Utils::parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1")));
+}
+
+TEST(GameState, MatchesMoveGeneration) {
+    PieceSteps::load();
+    for(std::string_view fen: {
+            "8/k1P5/8/1K6/8/8/8/8 w - - 0 1",
+            "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"}) {
+        std::vector<ExtendedBoard> positions{Utils::parseFEN(fen)};
+        for(size_t begin = 0, ply = 0; ply < 3; ply++) {
+            size_t end = positions.size();
+            for(size_t i = begin; i < end; i++) {
+                MoveCollectors::SuccessorBoards::getLegalMoves(positions[i]);
+                for(const ExtendedBoard& successor: MoveCollectors::SuccessorBoards::positions) positions.push_back(successor);
+            }
+            begin = end;
+        }
+
+        for(ExtendedBoard& position: positions) {
+            MoveCollectors::SuccessorBoards::getLegalMoves(position);
+            ASSERT_EQ(GameState::hasLegalMove(position), !MoveCollectors::SuccessorBoards::positions.empty())
+                << Utils::toFEN(position.board, position.state_code);
+        }
+    }
+}
+
+TEST(Profiling, CountsStages) {
+    PieceSteps::load();
+    using Profiled = MoveCollectors::LimitedDFS<false, false, MovePolicy::CopyMake, true>;
+    static_assert(Profiling::enabled<Profiled> && !Profiling::enabled<Collector>);
+
+    Board board = STARTBOARD;
+    Profiling::reset();
+    Profiled::generateGameTree<STARTSTATE, 3>(board);
+    ASSERT_EQ(Profiled::totalNodes, 8'902);
+
+    uint64_t reloads = 0, nextBoards = 0;
+    for(int depth = 0; depth < Profiling::MAX_DEPTH; depth++) {
+        reloads += Profiling::counters.calls[depth][Profiling::Reload];
+        nextBoards += Profiling::counters.calls[depth][Profiling::NextBoard];
+    }
+    ASSERT_EQ(reloads, 1 + 20 + 400);
+    ASSERT_EQ(nextBoards, 20 + 400 + 8'902);
+}
+
+TEST(MoveOrdering, ScoresAndPicks) {
+    using namespace MoveOrdering;
+    ASSERT_GT(mvvLva(Piece::Queen, Piece::Pawn), mvvLva(Piece::Queen, Piece::Rook));
+    ASSERT_GT(mvvLva(Piece::Rook, Piece::Queen), mvvLva(Piece::Knight, Piece::Pawn));
+
+    Killers killers;
+    History history;
+    PackedMove quiet = packMove(newMask(6), newMask(21), MoveFlag::Silent);
+    PackedMove killer = packMove(newMask(1), newMask(18), MoveFlag::Silent);
+    PackedMove capture = packMove(newMask(28), newMask(35), MoveFlag::Silent);
+    killers.store(3, killer);
+    history.update(true, quiet, 4);
+
+    MoveList<> list;
+    for(auto [move, captured]: {std::pair{quiet, Piece_t{0}}, {killer, Piece_t{0}}, {capture, Piece::Pawn}}) {
+        ScoredMove& m = list.add();
+        m.move = move;
+        m.piece = Piece::Knight;
+        m.captured = captured;
+    }
+    list.score(true, 3, killers, history);
+    ASSERT_EQ(list.pick(0).move, capture);
+    ASSERT_EQ(list.pick(1).move, killer);
+    ASSERT_EQ(list.pick(2).move, quiet);
+    ASSERT_EQ(list[2].score, 16);
+}
+
+TEST(Search, OrderingKeepsScoreAndSavesNodes) {
+    PieceSteps::load();
+    Search::AlphaBeta::clear();
+    ASSERT_EQ(Search::AlphaBeta::search(Utils::parseFEN("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"), 3).score, Search::MATE - 1);
+
+    for(std::string_view fen: {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"}) {
+        ExtendedBoard root = Utils::parseFEN(fen);
+        Search::AlphaBeta::clear();
+        unsigned long long unordered = 0, ordered = 0;
+        for(int depth = 1; depth <= 4; depth++) {
+            Search::Result plain = Search::AlphaBeta::search(root, depth, false);
+            Search::Result sorted = Search::AlphaBeta::search(root, depth, true);
+            ASSERT_EQ(plain.score, sorted.score) << fen << " depth " << depth;
+            unordered += plain.nodes;
+            ordered += sorted.nodes;
+        }
+        ASSERT_LT(ordered, unordered) << fen;
+    }
+}
+
+TEST(SEE, AttackersTo) {
+    PieceSteps::load();
+    Board board = STARTBOARD;
+    ASSERT_EQ(SEE::attackersTo(board, 21, board.occ()), newMask(6) | newMask(12) | newMask(14));
+    // the queen only attacks d3 once the pawn on d2 is gone
+    ASSERT_EQ(SEE::attackersTo(board, 19, board.occ()), newMask(10) | newMask(12));
+    ASSERT_EQ(SEE::attackersTo(board, 19, board.occ() & ~newMask(11)), newMask(3) | newMask(10) | newMask(12));
+}
+
+TEST(SEE, Exchanges) {
+    PieceSteps::load();
+    auto see = [](std::string_view fen, int from, int to, Flag_t flags = MoveFlag::Silent) {
+        ExtendedBoard eboard = Utils::parseFEN(fen);
+        return SEE::evaluate<true>(eboard.board, newMask(from), newMask(to), flags);
+    };
+    // undefended pawn
+    ASSERT_EQ(see("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", 4, 36), 100);
+    // knight takes a pawn defended by knight and bishop and loses the knight
+    ASSERT_EQ(see("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", 19, 36), 100 - 320);
+    // the rook on d1 joins through d2 and recaptures the knight
+    ASSERT_EQ(see("4k3/2n5/8/3p4/8/8/3R4/3RK3 w - - 0 1", 11, 35), 100 - 500 + 320);
+    // pawn defended by a pawn, the queen takes anyway
+    ASSERT_EQ(see("4k3/8/2p5/3p4/8/8/8/3QK3 w - - 0 1", 3, 35), 100 - 900);
+    // en passant, recaptured by the rook
+    ASSERT_EQ(see("3rk3/8/8/3pP3/8/8/8/4K3 w - d6 0 2", 36, 43, MoveFlag::EnPassantCapture), 0);
+    // a quiet move onto an attacked square
+    ASSERT_EQ(see("4k3/8/2p5/8/8/8/8/3QK3 w - - 0 1", 3, 35), -900);
+}
+
+// records the moves of the full generation that capture or promote and those of the captures only generation
+struct CaptureRecorder {
+    static inline std::vector<PackedMove> filtered{}, generated{};
+
+    template<State state, int depth>
+    static void main(Board& board) {
+        filtered.clear();
+        generated.clear();
+        MoveGenerator<CaptureRecorder>::template generate<state, 1>(board);
+        MoveGenerator<Captures>::template generate<state, 1>(board);
+    }
+
+    template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+    static void registerMove(const Board& board, BB from, BB to) {
+        if((to & board.enemyPieces<state.whiteToMove>()) || flags == MoveFlag::EnPassantCapture || isPromotion(flags))
+            filtered.push_back(packMove(from, to, flags));
+    }
+
+    template<State nextState, int depth>
+    static void next([[maybe_unused]] Board& nextBoard) {}
+
+    struct Captures {
+        static constexpr bool capturesOnly = true;
+
+        template<State state, int depth, Piece_t piece, Flag_t flags = MoveFlag::Silent>
+        static void registerMove([[maybe_unused]] const Board& board, BB from, BB to) {
+            generated.push_back(packMove(from, to, flags));
+        }
+
+        template<State nextState, int depth>
+        static void next([[maybe_unused]] Board& nextBoard) {}
+    };
+};
+
+TEST(MoveGenerator, CapturesOnly) {
+    PieceSteps::load();
+    for(std::string_view fen: {
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+        ExtendedBoard root = Utils::parseFEN(fen);
+        MoveCollectors::SuccessorBoards::getLegalMoves(root);
+        std::vector<ExtendedBoard> positions{root};
+        for(const ExtendedBoard& successor: MoveCollectors::SuccessorBoards::positions) positions.push_back(successor);
+        for(ExtendedBoard& position: positions) {
+            Utils::run<CaptureRecorder, 1>(position.state_code, position.board);
+            ASSERT_EQ(CaptureRecorder::generated, CaptureRecorder::filtered) << Utils::toFEN(position.board, position.state_code);
+        }
+    }
+}
+
+TEST(MoveGenerator, Evasions) {
+    PieceSteps::load();
+    for(std::string_view fen: {
+            // a bishop check that a knight can block, and a knight check
+            "4k3/8/8/8/1b6/8/1P2P3/RN2K2R w KQ - 0 1",
+            "4k3/8/8/8/8/5n2/8/R1B1K2R w KQ - 0 1",
+            // the checking pawn can be captured en passant
+            "8/8/8/2k5/3Pp3/8/8/K3Q3 b - d3 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+        ExtendedBoard root = Utils::parseFEN(fen);
+        std::vector<ExtendedBoard> positions{root};
+        for(size_t begin = 0, ply = 0; ply < 2; ply++) {
+            size_t end = positions.size();
+            for(size_t i = begin; i < end; i++) {
+                MoveCollectors::SuccessorBoards::getLegalMoves(positions[i]);
+                for(const ExtendedBoard& successor: MoveCollectors::SuccessorBoards::positions) positions.push_back(successor);
+            }
+            begin = end;
+        }
+        for(ExtendedBoard& position: positions) {
+            Utils::run<MoveRecorder, 1>(position.state_code, position.board);
+            ASSERT_EQ(MoveRecorder::iterated, MoveRecorder::generated) << Utils::toFEN(position.board, position.state_code);
+        }
+    }
+}
+
+TEST(TranspositionTable, StoreAndProbe) {
+    TranspositionTable table{1};
+    uint64_t key = 0x123456789abcdef0, other = key + table.size();   // same slot, different key
+    TranspositionTable::Data data;
+    ASSERT_FALSE(table.probe(key, data));
+
+    table.store(key, { -1234, packMove(newMask(12), newMask(28), MoveFlag::PawnDoublePush), 5, TranspositionTable::Exact });
+    ASSERT_TRUE(table.probe(key, data));
+    ASSERT_EQ(data.score, -1234);
+    ASSERT_EQ(data.move, packMove(newMask(12), newMask(28), MoveFlag::PawnDoublePush));
+    ASSERT_EQ(data.depth, 5);
+    ASSERT_EQ(data.bound, TranspositionTable::Exact);
+    ASSERT_FALSE(table.probe(other, data));
+
+    // a shallower result of another position does not replace a deeper one of the same search
+    table.store(other, { 1, 0, 3, TranspositionTable::Lower });
+    ASSERT_TRUE(table.probe(key, data));
+    ASSERT_FALSE(table.probe(other, data));
+    // but it does once the entry is from an older search
+    table.newSearch();
+    table.store(other, { 1, 0, 3, TranspositionTable::Lower });
+    ASSERT_FALSE(table.probe(key, data));
+    ASSERT_TRUE(table.probe(other, data));
+
+    // a result without a move keeps the move stored before
+    table.store(other, { 2, packMove(newMask(1), newMask(18), MoveFlag::Silent), 4, TranspositionTable::Exact });
+    table.store(other, { 3, 0, 5, TranspositionTable::Upper });
+    ASSERT_TRUE(table.probe(other, data));
+    ASSERT_EQ(data.move, packMove(newMask(1), newMask(18), MoveFlag::Silent));
+    ASSERT_EQ(data.score, 3);
+}
+
+TEST(LargePages, Allocate) {
+    // 3 MB constructed by 3 threads, on whatever pages the system grants
+    size_t count = 3 * LargePages::MB / sizeof(uint64_t);
+    LargePages::Array<uint64_t> large = LargePages::make<uint64_t>(count, true, 3);
+    ASSERT_NE(large.get(), nullptr);
+    ASSERT_GE(large.get_deleter().bytes, count * sizeof(uint64_t));
+    for(size_t i = 0; i < count; i++) ASSERT_EQ(large[i], 0);
+    large[count - 1] = 1;
+
+    LargePages::Array<uint64_t> small = LargePages::make<uint64_t>(count, false);
+    ASSERT_EQ(small.get_deleter().pages, LargePages::Pages::Small);
+
+    // a table on normal pages behaves like one on large pages
+    TranspositionTable table{2, false};
+    TranspositionTable::Data data;
+    table.store(42, { 7, 0, 1, TranspositionTable::Exact });
+    table.clear(2);
+    ASSERT_FALSE(table.probe(42, data));
+    table.store(42, { 7, 0, 1, TranspositionTable::Exact });
+    ASSERT_TRUE(table.probe(42, data));
+    ASSERT_EQ(data.score, 7);
+}
+
+TEST(Search, LazySMP) {
+    PieceSteps::load();
+    TranspositionTable table{4};
+    for(unsigned threads: {1u, 2u, 3u}) {
+        table.clear();
+        Search::Result mate = Search::LazySMP::search(Utils::parseFEN("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"), 4, threads, table);
+        ASSERT_EQ(mate.score, Search::MATE - 1);
+        ASSERT_EQ(mate.best, packMove(newMask(3), newMask(59), MoveFlag::Silent));
+
+        // the queen on c6 hangs to the bishop
+        table.clear();
+        Search::Result capture = Search::LazySMP::search(Utils::parseFEN("4k3/8/2q5/8/8/8/6B1/4K3 w - - 0 1"), 3, threads, table);
+        ASSERT_EQ(capture.best, packMove(newMask(14), newMask(42), MoveFlag::Silent));
+        ASSERT_GT(capture.score, 0);
+    }
+}
+
+// The real Random64 array is not part of the tree, the tests run on made up numbers and check how they are combined
+TEST(Polyglot, KeysAndBook) {
+    PieceSteps::load();
+    std::filesystem::path dir = std::filesystem::temp_directory_path();
+    std::string randomsPath = (dir / "dory_random64.txt").string(), bookPath = (dir / "dory_book.bin").string();
+
+    Polyglot::Randoms expected{};
+    uint64_t seed = 1;
+    FILE* file = std::fopen(randomsPath.c_str(), "w");
+    for(uint64_t& r: expected) std::fprintf(file, "0x%016llX,\n", static_cast<uLong>(r = Zobrist::nextRandom(seed)));
+    std::fclose(file);
+    Polyglot::Randoms r = Polyglot::loadRandoms(randomsPath);
+    ASSERT_EQ(r, expected);
+
+    // e2e4 moves the white pawn (kind 1) and passes the move, there is no black pawn to capture en passant
+    ExtendedBoard start{ STARTBOARD, getStateCode<STARTSTATE>() };
+    uint64_t startKey = Polyglot::hash(r, start.board, start.state_code);
+    ExtendedBoard e4 = Utils::parseFEN("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    ASSERT_EQ(startKey ^ Polyglot::hash(r, e4.board, e4.state_code), r[64 + 12] ^ r[64 + 28] ^ r[Polyglot::TURN_OFFSET]);
+    // with a black pawn on d4 the e3 square counts
+    ExtendedBoard ep = Utils::parseFEN("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    ExtendedBoard noEp = Utils::parseFEN("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    ASSERT_EQ(Polyglot::hash(r, ep.board, ep.state_code) ^ Polyglot::hash(r, noEp.board, noEp.state_code), r[Polyglot::EN_PASSANT_OFFSET + 4]);
+    ExtendedBoard noCastling = Utils::parseFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1");
+    ASSERT_EQ(startKey ^ Polyglot::hash(r, noCastling.board, noCastling.state_code), r[768] ^ r[769] ^ r[770] ^ r[771]);
+
+    // a book with e2e4, a move that is not legal and, in a second position, castling short as e1h1
+    ExtendedBoard castle = Utils::parseFEN("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    uint64_t castleKey = Polyglot::hash(r, castle.board, castle.state_code);
+    std::vector<Polyglot::Entry> entries{ { startKey, 12 << 6 | 28, 10, 0 }, { startKey, 12 << 6 | 36, 5, 0 },
+                                          { castleKey, 4 << 6 | 7, 1, 0 } };
+    std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.key < b.key; });
+    file = std::fopen(bookPath.c_str(), "wb");
+    for(const Polyglot::Entry& e: entries) {
+        unsigned char bytes[16];
+        for(int i = 0; i < 8; i++) bytes[i] = static_cast<unsigned char>(e.key >> (56 - 8 * i));
+        bytes[8] = e.move >> 8; bytes[9] = e.move & 0xff;
+        bytes[10] = e.weight >> 8; bytes[11] = e.weight & 0xff;
+        bytes[12] = bytes[13] = bytes[14] = bytes[15] = 0;
+        std::fwrite(bytes, 1, 16, file);
+    }
+    std::fclose(file);
+
+    {
+        Polyglot::Book book{bookPath};
+        ASSERT_EQ(book.size(), 3);
+        ASSERT_EQ(book.probe(startKey).size(), 2);
+        ASSERT_TRUE(book.probe(startKey ^ 1).empty());
+
+        std::vector<Polyglot::BookMove> moves = book.moves(r, start);
+        ASSERT_EQ(moves.size(), 1);
+        ASSERT_EQ(moves[0].move, packMove(newMask(12), newMask(28), MoveFlag::PawnDoublePush));
+        ASSERT_EQ(moves[0].weight, 10);
+        ASSERT_EQ(moves[0].next, e4);
+
+        moves = book.moves(r, castle);
+        ASSERT_EQ(moves.size(), 1);
+        ASSERT_EQ(moves[0].move, packMove(newMask(4), newMask(6), MoveFlag::ShortCastling));
+    }
+    std::filesystem::remove(randomsPath);
+    std::filesystem::remove(bookPath);
+}
+
+TEST(Tablebase, SymmetriesAndIndex) {
+    PieceSteps::load();
+    ExtendedBoard e = Utils::parseFEN("8/8/8/8/8/2k5/8/K2Q4 b - - 0 1");
+    ASSERT_EQ(Tablebase::transformed(Tablebase::transformed(e.board, Tablebase::transpose), Tablebase::transpose), e.board);
+    ASSERT_EQ(Tablebase::swapColors(Tablebase::swapColors(e.board)), e.board);
+    ASSERT_EQ(Tablebase::Material::of(e.board).name(), "KQvK");
+    ASSERT_EQ(Tablebase::Material::parse("KvKRP").swapped().name(), "KRPvK");
+
+    // all eight images of a pawnless position have the same canonical form, with pawns only the file mirror counts
+    ExtendedBoard other = Utils::parseFEN("8/1q6/8/2K5/8/8/6k1/8 w - - 0 1");
+    Board image = Tablebase::canonical(other.board, false);
+    for(auto f: { Tablebase::mirrorFiles, Tablebase::mirrorRanks, Tablebase::transpose })
+        ASSERT_EQ(Tablebase::canonical(Tablebase::transformed(other.board, f), false), image);
+    ASSERT_EQ(singleBitOf(image.wKing), 19);
+
+    Tablebase::Layout layout{Tablebase::Material::parse("KRRvK")};
+    ExtendedBoard rooks = Utils::parseFEN("8/8/8/2k5/8/1R6/8/K6R w - - 0 1");
+    uint64_t index = layout.index(Tablebase::canonical(rooks.board, false), true);
+    Board board;
+    bool white;
+    ASSERT_TRUE(layout.position(index, board, white));
+    ASSERT_TRUE(white);
+    ASSERT_EQ(board, Tablebase::canonical(rooks.board, false));
+}
+
+TEST(Tablebase, GenerateAndProbe) {
+    PieceSteps::load();
+    std::string dir = (std::filesystem::temp_directory_path() / "dory_tablebases").string();
+    std::filesystem::remove_all(dir);
+    {
+        Tablebase::Generator generator{dir, 2};
+        std::vector<Tablebase::Stats> built = generator.build("KPvK");
+        ASSERT_EQ(built.size(), 6);     // KvK, KQvK, KRvK, KBvK, KNvK and KPvK
+        for(const Tablebase::Stats& stats: built) {
+            if(stats.name == "KQvK") { ASSERT_EQ(stats.longest, 20); }
+            if(stats.name == "KRvK") { ASSERT_EQ(stats.longest, 32); }
+            if(stats.name == "KBvK" || stats.name == "KNvK") { ASSERT_EQ(stats.wins + stats.losses, 0); }
+        }
+        ASSERT_TRUE(generator.build("KRvK").empty());
+    }
+
+    Tablebase::Tablebases tables{dir};
+    ASSERT_EQ(tables.pieces(), 3);
+    auto probe = [&](std::string_view fen) {
+        ExtendedBoard e = Utils::parseFEN(fen);
+        std::optional<Tablebase::Result> result = tables.probe(e.board, e.state_code);
+        EXPECT_EQ(result.has_value(), true);
+        EXPECT_EQ(tables.probeWDL(e.board, e.state_code), result->wdl);
+        return *result;
+    };
+    auto expect = [&](std::string_view fen, Tablebase::WDL wdl, int dtm) {
+        Tablebase::Result result = probe(fen);
+        ASSERT_EQ(result.wdl, wdl);
+        ASSERT_EQ(result.dtm, dtm);
+    };
+    expect("k7/8/1K6/8/8/8/8/7Q b - - 0 1", Tablebase::Loss, 2);
+    expect("k7/8/1K6/8/8/8/8/7Q w - - 0 1", Tablebase::Invalid, 0);
+    expect("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1", Tablebase::Draw, 0);           // stalemate
+    expect("k7/8/1K6/8/8/8/8/6Q1 w - - 0 1", Tablebase::Win, 1);
+    expect("8/8/8/8/8/2k5/8/K2Q4 b - - 0 1", Tablebase::Loss, 12);
+    expect("8/8/8/8/8/8/kq6/7K w - - 0 1", Tablebase::Loss, 12);             // colors swapped
+    ASSERT_EQ(probe("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1").wdl, Tablebase::Win);
+    ASSERT_EQ(probe("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1").wdl, Tablebase::Loss);
+    ASSERT_EQ(probe("4k3/8/8/4P3/4K3/8/8/8 b - - 0 1").wdl, Tablebase::Draw);
+
+    ExtendedBoard castling = Utils::parseFEN("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1");
+    ASSERT_FALSE(tables.probe(castling.board, castling.state_code).has_value());
+    std::filesystem::remove_all(dir);
+}
+
+TEST(PGN, SANRoundTrip) {
+    PieceSteps::load();
+    PGN::SAN san;
+    ASSERT_TRUE(PGN::parseSAN("Nbxd7+", san));
+    ASSERT_EQ(san.piece, Piece::Knight);
+    ASSERT_EQ(san.to, 51);
+    ASSERT_EQ(san.fromFile, 1);
+    ASSERT_TRUE(PGN::parseSAN("exd8=Q#", san));
+    ASSERT_EQ(san.special, MoveFlag::PromoteQueen);
+    ASSERT_TRUE(PGN::parseSAN("0-0-0", san));
+    ASSERT_EQ(san.special, MoveFlag::LongCastling);
+    ASSERT_FALSE(PGN::parseSAN("Nd9", san));
+    ASSERT_FALSE(PGN::parseSAN("Nd4=Q", san));
+
+    ExtendedBoard rooks = Utils::parseFEN("4k3/8/8/R7/8/8/8/R4RK1 w - - 0 1");
+    ASSERT_EQ(PGN::toSAN(rooks, packMove(newMask(0), newMask(3), MoveFlag::Silent)), "Rad1");
+    ASSERT_EQ(PGN::toSAN(rooks, packMove(newMask(0), newMask(16), MoveFlag::Silent)), "R1a3");
+    ASSERT_EQ(PGN::toSAN(rooks, packMove(newMask(32), newMask(36), MoveFlag::Silent)), "Re5+");
+
+    // every legal move survives the way to SAN and back
+    for(std::string_view fen: {
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"}) {
+        ExtendedBoard root = Utils::parseFEN(fen);
+        MoveCollectors::SuccessorBoards::getLegalMoves(root);
+        std::vector<ExtendedBoard> positions{root};
+        for(const ExtendedBoard& successor: MoveCollectors::SuccessorBoards::positions) positions.push_back(successor);
+
+        for(ExtendedBoard& position: positions) {
+            Utils::run<MoveRecorder, 1>(position.state_code, position.board);
+            for(auto [move, piece]: MoveRecorder::generated) {
+                std::string text = PGN::toSAN(position, move);
+                ExtendedBoard next = position;
+                PackedMove played;
+                ASSERT_TRUE(PGN::play(next, text, played)) << text;
+                ASSERT_EQ(played, move) << text;
+            }
+        }
+    }
+}
+
+TEST(PGN, ReplayGames) {
+    PieceSteps::load();
+    std::string_view text =
+        "[Event \"Fried Liver\"]\n[White \"A\"]\n[Black \"B\"]\n[Result \"1-0\"]\n\n"
+        "1. e4 e5 2. Nf3 Nc6 3. Bc4 Nf6 4. Ng5 d5 5. exd5 Nxd5?! {the knight is lost (soon)} 6. Nxf7 $1 Kxf7\n"
+        "7. Qf3+ Ke6 8. Nc3 Ncb4 (8... Nce7 9. d4 ; a line comment\n) 9. O-O c6 10. d4 1-0\n\n"
+        "[Event \"Promotion\"]\n[FEN \"4k3/1P6/8/3pP3/8/8/8/4K3 w - d6 0 1\"]\n\n"
+        "1.exd6 e.p. Kd7 2.b8=N+ Kxd6 3... * \n\n"
+        "[Event \"Illegal\"]\n\n1. e4 e5 2. e5 *\n";
+
+    std::vector<std::string> finals(3);
+    std::vector<int> plies(3);
+    for(unsigned threads: {1u, 2u}) {
+        PGN::Stats stats = PGN::replayAll(text, threads, [&](unsigned, const PGN::Game& game, const ExtendedBoard& position, PackedMove move, int ply) {
+            size_t i = game.tag("Event") == "Fried Liver" ? 0 : game.tag("Event") == "Promotion" ? 1 : 2;
+            plies[i] = ply;
+            if(!move) finals[i] = Utils::toFEN(position.board, position.state_code);
+        });
+        ASSERT_EQ(stats.games, 3);
+        ASSERT_EQ(stats.positions, 20 + 5 + 2);
+        ASSERT_EQ(stats.errors, 1);
+        ASSERT_EQ(stats.errorToken, "e5");
+        ASSERT_EQ(finals[0], "r1bq1b1r/pp4pp/2p1k3/3np3/1nBP4/2N2Q2/PPP2PPP/R1B2RK1 b - d3 0 10");
+        ASSERT_EQ(finals[1], "1N6/8/3k4/8/8/8/8/4K3 w - - 0 3");
+        ASSERT_EQ(plies[2], 1);
+    }
+}